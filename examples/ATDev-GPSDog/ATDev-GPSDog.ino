@@ -20,6 +20,19 @@ SIM5218 modem;
 
 uint16_t storeIdx = ATDEV_SMS_NO_MSG;
 
+// Modem ring indicator pin (low active)
+// In power-down sleep (GPSDog idle mode) only a LOW level or a pin change
+// interrupt can wake up the AVR, a FALLING edge interrupt not. So it use
+// the pin change interrupt, pin 0 - 7 are on PCINT2_vect.
+#define RI_PIN 3
+
+// AT+CGPSINFO of SIM5218 has a position only with a fix, but no fix type,
+// satellites or HDOP. So a position is a good fix and a empty answer is
+// no fix. With a NMEA receiver use the values of $GPGGA / $GPGSA.
+#define GPS_FIX_TYPE GPSDOG_GPS_FIX_3D
+#define GPS_SATS GPSDOG_GPS_QUALITY_SATS
+#define GPS_HDOP GPSDOG_GPS_QUALITY_HDOP
+
 
 /**
  * Arduino setup scatch
@@ -41,7 +54,15 @@ void setup() {
                     static_cast<uint8_t>(ATDEV_SMS_NUM_SIZE), 
                     &(modem.m_smsData.m_message[0]), 
                     static_cast<uint8_t>(ATDEV_SMS_TXT_SIZE),
-                    &sendSMS, &checkSMS, &reloadSMS, &receiveGPS);
+                    &sendSMS, &checkSMS, &receiveGPS);
+  gpsDog.setBroadcastCallback(&broadcastSMS);
+
+  // new SMS signal over modem ring indicator (pin change interrupt)
+  pinMode(RI_PIN, INPUT_PULLUP);
+  *digitalPinToPCMSK(RI_PIN) |= bit(digitalPinToPCMSKbit(RI_PIN));
+  PCIFR |= bit(digitalPinToPCICRbit(RI_PIN));
+  PCICR |= bit(digitalPinToPCICRbit(RI_PIN));
+  gpsDog.enableSMSSignal();
 }
 
 /**
@@ -52,24 +73,56 @@ void loop() {
   gpsDog.mainProcessing();
 }
 
-void sendSMS()
+ISR(PCINT2_vect)
+{
+  // only the falling edge of ring indicator
+  if (digitalRead(RI_PIN) == LOW) {
+    gpsDog.signalNewSMS();
+  }
+}
+
+bool isNetworkReady()
 {
   uint8_t state;
   
   // modem response
   if (modem.isReady() != ATDEV_OK) {
-    return;
+    return false;
   }
   // Check Network Status
   state = modem.getNetworkStatus();
 
   // Check if Network if avilable
   if (state != ATDEV_NETSTAT_REGISTERED && state != ATDEV_NETSTAT_ROAMING) {
-    return;    
+    return false;
+  }
+
+  return true;
+}
+
+bool sendSMS()
+{
+  if (!isNetworkReady()) {
+    return false;
   }
 
   // Send SMS
-  modem.sendSMS();
+  return modem.sendSMS() == ATDEV_OK;
+}
+
+void broadcastSMS(uint8_t count)
+{
+  // check modem only once for all numbers
+  if (!isNetworkReady()) {
+    return;
+  }
+
+  // Send SMS to every number
+  for (uint8_t i = 0; i < count; i++) {
+    if (gpsDog.loadBroadcastNumber(i)) {
+      gpsDog.setBroadcastResult(i, modem.sendSMS() == ATDEV_OK);
+    }
+  }
 }
 
 void receiveGPS()
@@ -109,8 +162,13 @@ void receiveGPS()
     gpsDog.updateGPSData(modem.m_gpsData.m_latitude,
                          modem.m_gpsData.m_longitude,
                          modem.m_gpsData.m_speed,
+                         GPS_FIX_TYPE, GPS_SATS, GPS_HDOP,
                          date, time);
   }
+  else {
+    // no fix, GPSDog count the good fixes in a row new
+    gpsDog.updateGPSData(static_cast<int32_t>(0), static_cast<int32_t>(0), 0, GPSDOG_GPS_FIX_NONE, 0, 0xFFFF, NULL, NULL);
+  }
 }
 
 void checkSMS()
@@ -156,13 +214,3 @@ void checkSMS()
   storeIdx = ATDEV_SMS_NO_MSG;
 }
 
-void reloadSMS()
-{
-  // modem response
-  if (modem.isReady() != ATDEV_OK || storeIdx == ATDEV_SMS_NO_MSG) {
-    return;
-  }
-
-  modem.receiveSMS(storeIdx);
-}
-
@@ -0,0 +1,216 @@
+
+#ifndef GDDOG_H
+#define GDDOG_H
+
+// GPSDog with a fake modem and GPS receiver like the example sketch. The
+// test drive it with @see dogRun, every AT command to the modem is
+// counted.
+
+// includes
+#include "test.h"
+#include "GPSDog.h"
+
+// test numbers
+#define DOG_OWNER "+41791234567"
+#define DOG_OTHER "+41790000000"
+
+// start point of the fake GPS
+#define DOG_LAT 47000000
+#define DOG_LON 8000000
+
+/** The GPSDog of the test */
+static GPSDog       *s_dog          = NULL;
+
+/** SMS buffers of the modem */
+static char         s_number[GPSDOG_CONF_NUM_SIZE +1];
+static char         s_message[161];
+
+/** Incoming SMS they wait in the modem */
+static const char   *s_inNumber     = "";
+static const char   *s_inText       = NULL;
+static uint32_t     s_inTime        = 0;
+
+/** Last send SMS */
+static char         s_outText[161];
+static uint32_t     s_outTime       = 0;
+
+/** Network is up, else every send fails */
+static bool         s_online        = true;
+
+/** Position and fix type of the GPS receiver */
+static int32_t      s_gpsLat        = DOG_LAT;
+static int32_t      s_gpsLon        = DOG_LON;
+static uint8_t      s_gpsFix        = GPSDOG_GPS_FIX_3D;
+
+/** Counts of callbacks and AT commands */
+static uint32_t     s_sendCount     = 0;
+static uint32_t     s_checkCount    = 0;
+static uint32_t     s_gpsCount      = 0;
+static uint32_t     s_atCount       = 0;
+
+/** Date and time of a fix */
+static char         s_date[]        = "2024-01-01";
+static char         s_time[]        = "12:00";
+
+/**
+ * AT+CMGS after the network check.
+ */
+static inline bool dogSendSMS()
+{
+    s_atCount += 3;
+    s_sendCount++;
+
+    if (!s_online) {
+        return false;
+    }
+
+    strncpy(s_outText, s_message, sizeof(s_outText) -1);
+    s_outTime = g_millis;
+
+    return true;
+}
+
+/**
+ * Next index, a new SMS is read and deleted and the storage cleaned.
+ */
+static inline void dogCheckSMS()
+{
+    s_atCount += 2;
+    s_checkCount++;
+
+    if (s_inText == NULL) {
+        return;
+    }
+
+    s_atCount += 4;
+
+    memset(s_number, 0x00, sizeof(s_number));
+    memset(s_message, 0x00, sizeof(s_message));
+    strncpy(s_number, s_inNumber, sizeof(s_number) -1);
+    strncpy(s_message, s_inText, sizeof(s_message) -1);
+
+    s_inText = NULL;
+    s_dog->processIncomingSMS();
+}
+
+/**
+ * AT+CGPSINFO
+ */
+static inline void dogReceiveGPS()
+{
+    s_atCount += 2;
+    s_gpsCount++;
+
+    if (s_gpsFix < GPSDOG_GPS_FIX_2D) {
+        s_dog->updateGPSData(static_cast<int32_t>(0), static_cast<int32_t>(0), 0, GPSDOG_GPS_FIX_NONE, 0, 0xFFFF, NULL, NULL);
+        return;
+    }
+
+    s_dog->updateGPSData(s_gpsLat, s_gpsLon, 0, s_gpsFix, 8, 100, s_date, s_time);
+}
+
+/**
+ * Reset all counts and start a GPSDog like the sketch setup().
+ *
+ * @param dog               GPSDog of the test
+ * @param now               Millis value of the boot
+ */
+static inline void dogStart(GPSDog *dog, uint32_t now)
+{
+    s_dog       = dog;
+    g_millis    = now;
+    s_inText    = NULL;
+    s_online    = true;
+    s_gpsLat    = DOG_LAT;
+    s_gpsLon    = DOG_LON;
+    s_gpsFix    = GPSDOG_GPS_FIX_3D;
+    s_sendCount = 0;
+    s_checkCount = 0;
+    s_gpsCount  = 0;
+    s_atCount   = 0;
+    s_outTime   = 0;
+
+    memset(s_outText, 0x00, sizeof(s_outText));
+
+    dog->initialize(s_number, GPSDOG_CONF_NUM_SIZE, s_message, sizeof(s_message) -1, &dogSendSMS, &dogCheckSMS, &dogReceiveGPS);
+}
+
+/**
+ * A SMS arrive in the modem.
+ *
+ * @param number            Sender
+ * @param text              Message
+ */
+static inline void dogReceive(const char *number, const char *text)
+{
+    s_inNumber  = number;
+    s_inText    = text;
+    s_inTime    = g_millis;
+}
+
+/**
+ * Run @see GPSDog::tick on every deadline they it return until a time.
+ * A SMS can arrive at a time, the ring indicator signal it.
+ *
+ * @param until             Millis value to stop
+ * @param ring              Signal a new SMS like the ring indicator
+ * @return                  Count of ticks or 0 if a deadline is not in the future
+ */
+static inline uint32_t dogRun(uint32_t until, bool ring = false)
+{
+    uint32_t next;
+    uint32_t ticks = 0;
+
+    while (!GDTimer::isReached(until, g_millis)) {
+        next = s_dog->tick(g_millis);
+        ticks++;
+
+        // busy loop
+        if (GDTimer::isReached(next, g_millis) && ticks > 1000) {
+            return 0;
+        }
+
+        // next deadline or the end
+        if (GDTimer::isReached(until, next)) {
+            g_millis = until;
+        }
+        else if (!GDTimer::isReached(next, g_millis)) {
+            g_millis = next;
+        }
+
+        if (ring && s_inText != NULL) {
+            s_dog->signalNewSMS();
+        }
+    }
+
+    return ticks;
+}
+
+/**
+ * Send a command and run until the reply is send.
+ *
+ * @param text              Command
+ * @param ring              Signal the SMS like the ring indicator
+ * @return                  Millis from arrive to reply
+ */
+static inline uint32_t dogCommand(const char *text, bool ring = false)
+{
+    uint32_t start = g_millis;
+    uint32_t sends = s_sendCount;
+
+    dogReceive(DOG_OWNER, text);
+
+    if (ring) {
+        s_dog->signalNewSMS();
+    }
+
+    while (s_sendCount == sends && g_millis - start < 60000) {
+        dogRun(g_millis + 100);
+    }
+
+    return s_outTime - start;
+}
+
+#endif
+
+// vim: set sts=4 sw=4 ts=4 et:
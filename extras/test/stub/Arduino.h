@@ -0,0 +1,30 @@
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+// Host stub of the Arduino core for the tests
+
+// includes
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <math.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+
+/** Fake clock, the test set it */
+extern uint32_t g_millis;
+
+inline unsigned long millis() {
+    return g_millis;
+}
+
+inline void delay(unsigned long ms) {
+    g_millis += ms;
+}
+
+#endif
+
+// vim: set sts=4 sw=4 ts=4 et:
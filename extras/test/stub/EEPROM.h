@@ -0,0 +1,68 @@
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+// Host stub of the Arduino EEPROM library with a write count per cell
+
+// includes
+#include <inttypes.h>
+#include <string.h>
+
+// ATmega328P
+#define E2END 0x3FF
+
+/**
+ * Simulated EEPROM. A power loss can be simulated with a budget of
+ * writes, after that all writes are lost.
+ */
+class EEPROMClass
+{
+    public:
+
+        /** EEPROM cells */
+        uint8_t     m_mem[E2END +1];
+
+        /** Count of writes per cell */
+        uint32_t    m_writes[E2END +1];
+
+        /** Count of reads of all cells */
+        uint32_t    m_reads;
+
+        /** Count of writes until power is lost, -1 is never */
+        int32_t     m_budget;
+
+        EEPROMClass() {
+            this->erase();
+        }
+
+        /**
+         * Set all cells to 0xFF (new chip) and reset the counters.
+         */
+        void erase() {
+            memset(m_mem, 0xFF, sizeof(m_mem));
+            memset(m_writes, 0x00, sizeof(m_writes));
+            m_budget = -1;
+            m_reads  = 0;
+        }
+
+        uint8_t read(int addr);
+
+        void write(int addr, uint8_t val);
+
+        void update(int addr, uint8_t val) {
+            if (this->read(addr) != val) {
+                this->write(addr, val);
+            }
+        }
+
+        /**
+         * Get the max count of writes of a cell in a range.
+         */
+        uint32_t maxWrites(int start, int end);
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
+
+// vim: set sts=4 sw=4 ts=4 et:
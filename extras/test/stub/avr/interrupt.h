@@ -0,0 +1,14 @@
+
+#ifndef INTERRUPT_H
+#define INTERRUPT_H
+
+// Host stub, a ISR is a normal function the test can call
+
+#define ISR(vector, ...) extern "C" void vector(void) __VA_ARGS__; extern "C" void vector(void)
+
+inline void cli() {}
+inline void sei() {}
+
+#endif
+
+// vim: set sts=4 sw=4 ts=4 et:
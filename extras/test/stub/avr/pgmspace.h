@@ -0,0 +1,33 @@
+
+#ifndef PGMSPACE_H
+#define PGMSPACE_H
+
+// Host stub, PROGMEM is normal memory
+
+// includes
+#include <inttypes.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+#define pgm_read_byte(p) (*reinterpret_cast<const uint8_t*>(p))
+#define pgm_read_word(p) (*reinterpret_cast<const uint16_t*>(p))
+#define pgm_read_dword(p) (*reinterpret_cast<const uint32_t*>(p))
+
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strncpy_P strncpy
+#define strcasecmp_P strcasecmp
+#define strncasecmp_P strncasecmp
+#define snprintf_P snprintf
+#define sprintf_P sprintf
+
+#endif
+
+// vim: set sts=4 sw=4 ts=4 et:
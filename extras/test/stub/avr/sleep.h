@@ -0,0 +1,28 @@
+
+#ifndef SLEEP_H
+#define SLEEP_H
+
+// Host stub, the test simulate the wake up source in the hook
+
+// includes
+#include <inttypes.h>
+#include <stddef.h>
+
+#define SLEEP_MODE_PWR_DOWN 0x02
+
+/** Called for sleep_cpu(), NULL is a wake up without interrupt */
+extern void (*g_sleepHook)();
+
+inline void set_sleep_mode(uint8_t mode) {}
+inline void sleep_enable() {}
+inline void sleep_disable() {}
+
+inline void sleep_cpu() {
+    if (g_sleepHook != NULL) {
+        g_sleepHook();
+    }
+}
+
+#endif
+
+// vim: set sts=4 sw=4 ts=4 et:
@@ -0,0 +1,33 @@
+
+#ifndef WDT_H
+#define WDT_H
+
+// Host stub of the watchdog registers
+
+// includes
+#include <inttypes.h>
+
+#define _BV(bit) (1 << (bit))
+
+// WDTCSR
+#define WDP0 0
+#define WDP1 1
+#define WDP2 2
+#define WDE 3
+#define WDCE 4
+#define WDP3 5
+#define WDIE 6
+#define WDIF 7
+
+// MCUSR
+#define WDRF 3
+
+extern volatile uint8_t MCUSR;
+extern volatile uint8_t WDTCSR;
+
+inline void wdt_reset() {}
+inline void wdt_disable() {}
+
+#endif
+
+// vim: set sts=4 sw=4 ts=4 et:
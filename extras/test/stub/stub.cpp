@@ -0,0 +1,58 @@
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+uint32_t            g_millis    = 0;
+void                (*g_sleepHook)() = NULL;
+volatile uint8_t    MCUSR       = 0;
+volatile uint8_t    WDTCSR      = 0;
+
+EEPROMClass EEPROM;
+
+uint8_t EEPROMClass::read(int addr)
+{
+    if (addr < 0 || addr > E2END) {
+        fprintf(stderr, "EEPROM read out of range: %d\n", addr);
+        abort();
+    }
+
+    m_reads++;
+
+    return m_mem[addr];
+}
+
+void EEPROMClass::write(int addr, uint8_t val)
+{
+    if (addr < 0 || addr > E2END) {
+        fprintf(stderr, "EEPROM write out of range: %d\n", addr);
+        abort();
+    }
+
+    // power is lost
+    if (m_budget == 0) {
+        return;
+    }
+    if (m_budget > 0) {
+        m_budget--;
+    }
+
+    m_mem[addr] = val;
+    m_writes[addr]++;
+}
+
+uint32_t EEPROMClass::maxWrites(int start, int end)
+{
+    uint32_t max = 0;
+
+    for (int i = start; i < end && i <= E2END; i++) {
+        if (m_writes[i] > max) {
+            max = m_writes[i];
+        }
+    }
+
+    return max;
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
@@ -0,0 +1,45 @@
+
+#ifndef CRC16_H
+#define CRC16_H
+
+// Host stub with the C code from the avr-libc documentation
+
+// includes
+#include <inttypes.h>
+
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t a)
+{
+    crc ^= a;
+
+    for (uint8_t i = 0; i < 8; i++) {
+        if (crc & 1) {
+            crc = (crc >> 1) ^ 0xA001;
+        }
+        else {
+            crc = (crc >> 1);
+        }
+    }
+
+    return crc;
+}
+
+static inline uint8_t _crc8_ccitt_update(uint8_t inCrc, uint8_t inData)
+{
+    uint8_t data = inCrc ^ inData;
+
+    for (uint8_t i = 0; i < 8; i++) {
+        if ((data & 0x80) != 0) {
+            data <<= 1;
+            data ^= 0x07;
+        }
+        else {
+            data <<= 1;
+        }
+    }
+
+    return data;
+}
+
+#endif
+
+// vim: set sts=4 sw=4 ts=4 et:
@@ -0,0 +1,47 @@
+
+#ifndef GDTEST_H
+#define GDTEST_H
+
+// Minimal check macros for the host tests, every test is a own program
+
+// includes
+#include <stdio.h>
+
+static unsigned s_testChecks = 0;
+static unsigned s_testFails  = 0;
+
+/** Check a condition and count a failure */
+#define GD_CHECK(cond) \
+    do { \
+        s_testChecks++; \
+        if (!(cond)) { \
+            s_testFails++; \
+            printf("%s:%d: FAIL: %s\n", __FILE__, __LINE__, #cond); \
+        } \
+    } while (0)
+
+/** Check two integer values are equal and print both on failure */
+#define GD_CHECK_EQ(val, expect) \
+    do { \
+        long long _val = static_cast<long long>(val); \
+        long long _expect = static_cast<long long>(expect); \
+        s_testChecks++; \
+        if (_val != _expect) { \
+            s_testFails++; \
+            printf("%s:%d: FAIL: %s == %lld, expected %lld\n", __FILE__, __LINE__, #val, _val, _expect); \
+        } \
+    } while (0)
+
+/**
+ * Print the summary, use it as return value of main.
+ */
+static int gdTestResult(const char *name)
+{
+    printf("%s: %u checks, %u failed\n", name, s_testChecks, s_testFails);
+
+    return s_testFails == 0 ? 0 : 1;
+}
+
+#endif
+
+// vim: set sts=4 sw=4 ts=4 et:
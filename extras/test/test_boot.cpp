@@ -0,0 +1,178 @@
+
+// Boot profile: time and EEPROM reads of every startup phase
+
+#include <chrono>
+
+#include "dog.h"
+
+// runs of every phase for the time
+#define RUNS 2000
+
+/** EEPROM image of the profile */
+static EEPROMClass s_image;
+
+/** Time and EEPROM reads of a phase */
+struct BOOT_PHASE
+{
+    uint64_t    m_nanos;
+    uint32_t    m_reads;
+};
+
+/**
+ * Nanoseconds of the host clock.
+ */
+static uint64_t getNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Start of a phase run with the EEPROM image.
+ */
+static uint64_t startPhase()
+{
+    EEPROM = s_image;
+
+    return getNanos();
+}
+
+/**
+ * End of a phase run.
+ */
+static void endPhase(BOOT_PHASE *phase, uint64_t start)
+{
+    phase->m_nanos += getNanos() - start;
+    phase->m_reads = EEPROM.m_reads - s_image.m_reads;
+}
+
+/**
+ * Profile every phase of @see GPSDog::initialize with the image. The
+ * global constructor run before setup(), it may not read the EEPROM.
+ *
+ * @param name              Name of the image
+ * @param status            Expected config status
+ */
+static void profile(const char *name, uint8_t status)
+{
+    BOOT_PHASE  ctor    = {0, 0};
+    BOOT_PHASE  config  = {0, 0};
+    BOOT_PHASE  fence   = {0, 0};
+    BOOT_PHASE  snap    = {0, 0};
+    BOOT_PHASE  track   = {0, 0};
+    BOOT_PHASE  all     = {0, 0};
+    uint64_t    start;
+    uint8_t     result  = GPSDOG_CONF_LOAD_NONE;
+
+    for (uint16_t run = 0; run < RUNS; run++) {
+        {
+            start = startPhase();
+            GPSDog dog;
+            endPhase(&ctor, start);
+        }
+        {
+            start = startPhase();
+            GDConfig phase;
+            phase.loadConfig();
+            endPhase(&config, start);
+        }
+        {
+            start = startPhase();
+            GDFence phase;
+            phase.loadFence();
+            endPhase(&fence, start);
+        }
+        {
+            start = startPhase();
+            GDSnap phase;
+            phase.loadSnap();
+            endPhase(&snap, start);
+        }
+        {
+            start = startPhase();
+            GDTrack phase;
+            phase.loadTrack(0);
+            endPhase(&track, start);
+        }
+        {
+            start = startPhase();
+            GPSDog dog;
+            dog.initialize(s_number, GPSDOG_CONF_NUM_SIZE, s_message, sizeof(s_message) -1, &dogSendSMS, &dogCheckSMS, &dogReceiveGPS);
+            endPhase(&all, start);
+            result = dog.getConfigStatus();
+        }
+    }
+
+    printf("%-9s: constructor %5.1f us %3u reads, config %5.1f us %3u reads, fence %5.1f us %3u reads, snapshot %5.1f us %3u reads, "
+        "track %5.1f us %3u reads, initialize %5.1f us %4u reads\n", name,
+        ctor.m_nanos / 1000.0 / RUNS, ctor.m_reads, config.m_nanos / 1000.0 / RUNS, config.m_reads, fence.m_nanos / 1000.0 / RUNS, fence.m_reads,
+        snap.m_nanos / 1000.0 / RUNS, snap.m_reads, track.m_nanos / 1000.0 / RUNS, track.m_reads, all.m_nanos / 1000.0 / RUNS, all.m_reads);
+
+    // lazy load, nothing before setup()
+    GD_CHECK_EQ(ctor.m_reads, 0);
+    GD_CHECK_EQ(result, status);
+}
+
+/**
+ * Boot with a new chip, a used device and a broken journal page.
+ */
+static void testBoot()
+{
+    GPSDog      dog;
+    uint16_t    addr;
+    uint16_t    newest  = GPSDOG_CONF_JOURNAL_START;
+    uint16_t    seq     = 0;
+
+    ////
+    // new chip
+    EEPROM.erase();
+    s_image = EEPROM;
+    profile("new chip", GPSDOG_CONF_LOAD_FRESH);
+
+    ////
+    // used, 2 journal pages, zones, snapshot and a track
+    EEPROM.erase();
+    dogStart(&dog, 0);
+
+    dogCommand("INIT pw1234 " DOG_OWNER " 0 ON");
+    dogCommand("ZONE 1 CIRCLE 47.0,8.0 500");
+    dogCommand("ZONE 2 POLY 47.1,8.1 47.2,8.2 47.3,8.1 47.2,8.0");
+
+    for (uint8_t i = 0; i < 20; i++) {
+        dogCommand("PROTECT ON");
+        dogCommand("PROTECT OFF");
+    }
+
+    dogCommand("ALARM ON");
+
+    for (uint16_t i = 0; i < 360; i++) {
+        s_gpsLat += 1000;
+        dogRun(g_millis + GPSDOG_WAIT_GPS_MIN);
+    }
+
+    EEPROM.m_reads  = 0;
+    s_image         = EEPROM;
+    profile("used", GPSDOG_CONF_LOAD_OK);
+
+    ////
+    // newest journal page is broken, the older one is used
+    for (uint8_t i = 0; i < GPSDOG_CONF_JOURNAL_PAGES; i++) {
+        addr = GPSDOG_CONF_JOURNAL_START + i * GPSDOG_CONF_JOURNAL_PAGE_SIZE;
+
+        if (s_image.m_mem[addr] == GPSDOG_CONF_JOURNAL_MAGIC && (i == 0 || static_cast<int16_t>((s_image.m_mem[addr + 1] | (s_image.m_mem[addr + 2] << 8)) - seq) > 0)) {
+            newest  = addr;
+            seq     = s_image.m_mem[addr + 1] | (s_image.m_mem[addr + 2] << 8);
+        }
+    }
+
+    s_image.m_mem[newest + GPSDOG_CONF_JOURNAL_HEADER + 3] ^= 0xFF;
+    profile("recovered", GPSDOG_CONF_LOAD_RECOVERED);
+}
+
+int main()
+{
+    testBoot();
+
+    return gdTestResult("test_boot");
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
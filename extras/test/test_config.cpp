@@ -0,0 +1,357 @@
+
+// GDConfig EEPROM journal: wear, power loss and migration of 0x07
+
+#include "test.h"
+#include "GDConfig.h"
+
+/** Random value (xorshift32) */
+static uint32_t s_seed = 1;
+
+static uint32_t getRandom()
+{
+    s_seed ^= s_seed << 13;
+    s_seed ^= s_seed >> 17;
+    s_seed ^= s_seed << 5;
+
+    return s_seed;
+}
+
+/**
+ * Write a 0x07 image with 2 numbers to EEPROM.
+ */
+static void writeOldImage()
+{
+    GD_DATA_07  old;
+    uint8_t     *p = reinterpret_cast<uint8_t*>(&old);
+
+    memset(&old, 0x00, sizeof(GD_DATA_07));
+
+    old.m_version       = GPSDOG_CONF_VERSION_07;
+    old.m_isInit        = true;
+    old.m_isWatch       = true;
+    old.m_alarmInterval = 10;
+    old.m_unit          = GPSDOG_UNIT_MPH;
+    old.m_latitude      = 47.5;
+    old.m_longitude     = 8.25;
+    old.m_geoFix        = 0.001;
+
+    strcpy(old.m_password, "pw1234");
+    strcpy(old.m_numbers[0], "+41791234567");
+    strcpy(old.m_numbers[2], "0791112233");
+    old.m_signNums[0]       = 3;
+    old.m_signNums[2]       = 1;
+    old.m_alarmNumbers[0]   = true;
+
+    for (uint8_t i = 0; i < sizeof(GD_DATA_07); i++) {
+        EEPROM.write(GPSDOG_CONF_ADDR_07 + i, p[i]);
+    }
+}
+
+/**
+ * Check the config they is migrate from @see writeOldImage.
+ */
+static bool isMigrated(GDConfig &config)
+{
+    return config.isModeOn(GPSDOG_MODE_INIT) && config.isModeOn(GPSDOG_MODE_WATCH) && !config.isModeOn(GPSDOG_MODE_ALARM) &&
+        config.checkPassword(const_cast<char*>("pw1234")) && config.getAlarmInterval() == 10 && config.getUnit() == GPSDOG_UNIT_MPH &&
+        config.getStoreLatitude() == 47500000 && config.getStoreLongitude() == 8250000 && config.getStoreGeoRadius() == 112 &&
+        strcmp(config.getStoreNumber(0), "+41791234567") == 0 && config.getSignNumber(0) == 3 && config.isAlarmNotifyOn(0) &&
+        strcmp(config.getStoreNumber(1), "") == 0 &&
+        strcmp(config.getStoreNumber(2), "0791112233") == 0 && config.getSignNumber(2) == 1 && !config.isAlarmNotifyOn(2);
+}
+
+/**
+ * Migrate 0x07, power is lost after every count of writes. The next
+ * start need to finish it without losing data.
+ */
+static void testMigration()
+{
+    uint32_t    writes;
+    uint32_t    fails = 0;
+
+    // without power loss
+    EEPROM.erase();
+    writeOldImage();
+
+    {
+        GDConfig config;
+
+        GD_CHECK_EQ(config.loadConfig(), GPSDOG_CONF_LOAD_MIGRATED);
+        GD_CHECK(isMigrated(config));
+
+        // first write after start
+        config.writeConfig();
+        writes = config.getEEPROMWrites();
+    }
+
+    // journal is on the second page, the old image is removed
+    GD_CHECK_EQ(EEPROM.read(GPSDOG_CONF_JOURNAL_START + GPSDOG_CONF_JOURNAL_PAGE_SIZE), GPSDOG_CONF_JOURNAL_MAGIC);
+    GD_CHECK_EQ(EEPROM.read(GPSDOG_CONF_ADDR_07), 0x00);
+
+    // next start read the journal
+    {
+        GDConfig config;
+
+        GD_CHECK_EQ(config.loadConfig(), GPSDOG_CONF_LOAD_OK);
+        GD_CHECK(isMigrated(config));
+    }
+
+    for (uint32_t cut = 0; cut < writes; cut++) {
+        EEPROM.erase();
+        writeOldImage();
+        EEPROM.m_budget = cut;
+
+        {
+            GDConfig config;
+            config.loadConfig();
+            config.writeConfig();
+        }
+
+        EEPROM.m_budget = -1;
+
+        GDConfig config;
+
+        if (config.loadConfig() != GPSDOG_CONF_LOAD_MIGRATED || !isMigrated(config)) {
+            fails++;
+        }
+    }
+
+    printf("migration 0x07: %u writes, %u broken after power loss\n", writes, fails);
+    GD_CHECK_EQ(fails, 0);
+}
+
+/**
+ * Change one value again and again, power is lost on random writes. After
+ * a restart the value need to be the old or the new one.
+ */
+static void testPowerLoss()
+{
+    uint8_t     value   = 1;
+    uint32_t    cuts    = 0;
+    uint32_t    fails   = 0;
+
+    EEPROM.erase();
+
+    {
+        GDConfig config;
+
+        config.loadConfig();
+        config.setAlarmInterval(value);
+        config.writeConfig();
+    }
+
+    // over many journal pages
+    for (uint16_t i = 0; i < 2000; i++) {
+        uint8_t next = value % 200 +1;
+
+        GDConfig config;
+        config.loadConfig();
+
+        if (getRandom() % 4 == 0) {
+            EEPROM.m_budget = getRandom() % 8;
+            cuts++;
+        }
+
+        config.setAlarmInterval(next);
+        config.writeConfig();
+
+        EEPROM.m_budget = -1;
+
+        // restart
+        GDConfig check;
+        check.loadConfig();
+
+        if (check.getAlarmInterval() == next) {
+            value = next;
+        }
+        else if (check.getAlarmInterval() != value) {
+            fails++;
+        }
+    }
+
+    printf("power loss: %u cuts, %u broken\n", cuts, fails);
+    GD_CHECK(cuts > 300);
+    GD_CHECK_EQ(fails, 0);
+}
+
+/**
+ * WATCH ON change position and mode, they are not side by side. Power is
+ * lost after every count of writes, the config need to be the old or
+ * the new one, never a mix. The journal is new or used before.
+ */
+static void testWatchOn(uint8_t history)
+{
+    uint32_t    writes  = 0;
+    uint32_t    olds    = 0;
+    uint32_t    news    = 0;
+    uint32_t    fails   = 0;
+    uint32_t    start;
+
+    for (uint32_t cut = 0; cut == 0 || cut <= writes; cut++) {
+        EEPROM.erase();
+
+        {
+            GDConfig config;
+
+            config.loadConfig();
+
+            for (uint8_t i = 0; i <= history; i++) {
+                config.setAlarmInterval(i);
+                config.writeConfig();
+            }
+
+            config.setStoreLatitude(47000000);
+            config.setStoreLongitude(8000000);
+            config.writeConfig();
+
+            // WATCH ON
+            start           = config.getEEPROMWrites();
+            EEPROM.m_budget = cut == 0 ? -1 : cut -1;
+
+            config.beginConfig();
+            config.setStoreLatitude(47123456);
+            config.setStoreLongitude(8123456);
+            config.setMode(GPSDOG_MODE_WATCH, true);
+            config.commitConfig();
+
+            if (cut == 0) {
+                writes = config.getEEPROMWrites() - start;
+            }
+        }
+
+        EEPROM.m_budget = -1;
+
+        GDConfig check;
+        check.loadConfig();
+
+        if (!check.isModeOn(GPSDOG_MODE_WATCH) && check.getStoreLatitude() == 47000000 && check.getStoreLongitude() == 8000000) {
+            olds++;
+        }
+        else if (check.isModeOn(GPSDOG_MODE_WATCH) && check.getStoreLatitude() == 47123456 && check.getStoreLongitude() == 8123456) {
+            news++;
+        }
+        else {
+            fails++;
+        }
+    }
+
+    printf("WATCH ON with power loss (%u writes before): %u old, %u new, %u mixed\n", history, olds, news, fails);
+    GD_CHECK_EQ(fails, 0);
+    GD_CHECK(olds > 0 && news > 0);
+}
+
+/**
+ * One year with WATCH ON every day, a alarm on every third day and STOP.
+ * The old layout update the whole struct on address 0.
+ */
+static void testWear()
+{
+    EEPROMClass oldRom;
+    GD_DATA_07  old;
+    uint8_t     *p = reinterpret_cast<uint8_t*>(&old);
+    uint32_t    oldMax;
+    uint32_t    newMax;
+
+    EEPROM.erase();
+    memset(&old, 0x00, sizeof(GD_DATA_07));
+
+    GDConfig config;
+    config.loadConfig();
+    config.writeConfig();
+
+    for (uint16_t day = 0; day < 365; day++) {
+        int32_t lat = 47000000 + getRandom() % 100000;
+        int32_t lon = 8000000 + getRandom() % 100000;
+
+        for (uint8_t step = 0; step < 3; step++) {
+            switch (step) {
+                // WATCH ON
+                case 0:
+                    config.setStoreLatitude(lat);
+                    config.setStoreLongitude(lon);
+                    config.setMode(GPSDOG_MODE_WATCH, true);
+
+                    old.m_latitude  = lat / 1000000.0;
+                    old.m_longitude = lon / 1000000.0;
+                    old.m_isWatch   = true;
+                    break;
+
+                // alarm
+                case 1:
+                    if (day % 3 != 0) {
+                        continue;
+                    }
+
+                    config.setMode(GPSDOG_MODE_ALARM, true);
+                    old.m_isAlarm = true;
+                    break;
+
+                // STOP
+                default:
+                    config.setMode(GPSDOG_MODE_ALARM, false);
+                    config.setMode(GPSDOG_MODE_WATCH, false);
+                    old.m_isAlarm = false;
+                    old.m_isWatch = false;
+                    break;
+            }
+
+            config.writeConfig();
+
+            for (uint8_t i = 0; i < sizeof(GD_DATA_07); i++) {
+                oldRom.update(i, p[i]);
+            }
+        }
+    }
+
+    oldMax = oldRom.maxWrites(0, sizeof(GD_DATA_07));
+    newMax = EEPROM.maxWrites(GPSDOG_CONF_JOURNAL_START, GPSDOG_CONF_JOURNAL_START + GPSDOG_CONF_JOURNAL_PAGES * GPSDOG_CONF_JOURNAL_PAGE_SIZE);
+
+    printf("1 year: hottest cell %u writes (old layout %u), %u bytes written\n", newMax, oldMax, config.getEEPROMWrites());
+
+    GD_CHECK(newMax < oldMax);
+
+    // still readable
+    GDConfig check;
+    GD_CHECK_EQ(check.loadConfig(), GPSDOG_CONF_LOAD_OK);
+    GD_CHECK(!check.isModeOn(GPSDOG_MODE_WATCH));
+    GD_CHECK(check.getStoreLatitude() == config.getStoreLatitude());
+
+    ////
+    // One ALARM ON/OFF cycle write only the mode byte with a record, the
+    // journal page is new so it is not full
+    EEPROM.erase();
+
+    GDConfig cycle;
+    cycle.loadConfig();
+    cycle.writeConfig();
+
+    uint32_t start = cycle.getEEPROMWrites();
+
+    cycle.setMode(GPSDOG_MODE_ALARM, true);
+    cycle.writeConfig();
+
+    uint32_t alarmOn = cycle.getEEPROMWrites() - start;
+
+    cycle.setMode(GPSDOG_MODE_ALARM, false);
+    cycle.writeConfig();
+
+    uint32_t alarmOff = cycle.getEEPROMWrites() - start - alarmOn;
+
+    printf("ALARM ON: %u bytes written, OFF: %u bytes (config %u bytes)\n", alarmOn, alarmOff, static_cast<unsigned>(sizeof(GD_DATA)));
+
+    GD_CHECK(alarmOn > 0 && alarmOn <= 1 + GPSDOG_CONF_JOURNAL_RECORD);
+    GD_CHECK(alarmOff > 0 && alarmOff <= 1 + GPSDOG_CONF_JOURNAL_RECORD);
+}
+
+int main()
+{
+    testMigration();
+    testPowerLoss();
+    testWatchOn(0);
+    testWatchOn(60);
+    testWear();
+
+    return gdTestResult("test_config");
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
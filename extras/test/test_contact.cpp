@@ -0,0 +1,226 @@
+
+// GDConfig contact store: sign matching and lookup cost
+
+#include "test.h"
+#include "GDConfig.h"
+
+/**
+ * Old lookup: read every number from EEPROM and compare the end.
+ */
+static uint8_t oldLookup(const char *num)
+{
+    char        contact[GPSDOG_CONF_NUM_SIZE +1];
+    uint16_t    addr;
+    uint8_t     sign;
+    uint8_t     len;
+
+    for (uint8_t i = 0; i < GPSDOG_CONF_NUMBER_STORE; i++) {
+        addr = GPSDOG_CONF_CONTACT_START + i * GPSDOG_CONF_CONTACT_SIZE;
+        sign = EEPROM.read(addr) & GPSDOG_CONF_CONTACT_SIGN;
+
+        for (uint8_t y = 0; y < GPSDOG_CONF_NUM_SIZE; y++) {
+            contact[y] = EEPROM.read(addr + 1 + y);
+        }
+        contact[GPSDOG_CONF_NUM_SIZE] = 0x00;
+
+        len = strlen(contact);
+
+        if (len > sign && strlen(num) >= static_cast<size_t>(len - sign) && strcmp(contact + sign, num + strlen(num) - len + sign) == 0) {
+            return i;
+        }
+    }
+
+    return GPSDOG_CONF_NUMBER_STORE;
+}
+
+/**
+ * Numbers with a sign match with a other prefix.
+ */
+static void testSign()
+{
+    GDConfig config;
+
+    // fresh config need to be written like INIT, else next start reset it
+    EEPROM.erase();
+    config.loadConfig();
+    config.writeConfig();
+
+    GD_CHECK(config.addNumberWithNotify(0, const_cast<char*>("+41791234567"), 3, true));
+    GD_CHECK(config.addNumberWithNotify(1, const_cast<char*>("0791234568"), 0, false));
+    GD_CHECK(config.addNumberWithNotify(2, const_cast<char*>("1239999"), 0, false));
+
+    // sign is not smaller as the number
+    GD_CHECK(!config.addNumberWithNotify(3, const_cast<char*>("123"), 3, false));
+
+    GD_CHECK_EQ(config.getNumberIdxInStore(const_cast<char*>("+41791234567")), 0);
+    GD_CHECK_EQ(config.getNumberIdxInStore(const_cast<char*>("0791234567")), 0);
+    GD_CHECK_EQ(config.getNumberIdxInStore(const_cast<char*>("0041791234567")), 0);
+    GD_CHECK_EQ(config.getNumberIdxInStore(const_cast<char*>("0791234568")), 1);
+    GD_CHECK_EQ(config.getNumberIdxInStore(const_cast<char*>("+41791234568")), GPSDOG_CONF_NUMBER_STORE);
+    GD_CHECK_EQ(config.getNumberIdxInStore(const_cast<char*>("791234567")), 0);
+    GD_CHECK_EQ(config.getNumberIdxInStore(const_cast<char*>("91234567")), GPSDOG_CONF_NUMBER_STORE);
+    GD_CHECK_EQ(config.getNumberIdxInStore(NULL), GPSDOG_CONF_NUMBER_STORE);
+
+    // shorter number without sign
+    GD_CHECK_EQ(config.getNumberIdxInStore(const_cast<char*>("1239999")), 2);
+
+    GD_CHECK(config.isAlarmNotifyOn(0));
+    GD_CHECK_EQ(config.getSignNumber(0), 3);
+
+    // change keep number and sign
+    config.setAlarmNotify(0, false);
+    GD_CHECK(!config.isAlarmNotifyOn(0));
+    GD_CHECK(strcmp(config.getStoreNumber(0), "+41791234567") == 0);
+    GD_CHECK_EQ(config.getSignNumber(0), 3);
+
+    // delete
+    config.delStoreNumber(0);
+    GD_CHECK_EQ(config.getNumberIdxInStore(const_cast<char*>("0791234567")), GPSDOG_CONF_NUMBER_STORE);
+    GD_CHECK(strcmp(config.getStoreNumber(0), "") == 0);
+
+    // index is build on start
+    GDConfig check;
+    check.loadConfig();
+    GD_CHECK_EQ(check.getNumberIdxInStore(const_cast<char*>("+41791234568")), GPSDOG_CONF_NUMBER_STORE);
+    GD_CHECK_EQ(check.getNumberIdxInStore(const_cast<char*>("0791234568")), 1);
+}
+
+/**
+ * Contacts are staged in a transaction. Abort drop them, commit write
+ * them to EEPROM.
+ */
+static void testTransaction()
+{
+    GDConfig    config;
+    uint32_t    writes;
+
+    EEPROM.erase();
+    config.loadConfig();
+    config.writeConfig();
+    config.addNumberWithNotify(0, const_cast<char*>("+41791234567"), 3, true);
+
+    ////
+    // STORE ADD with error
+    writes = config.getEEPROMWrites();
+
+    config.beginConfig();
+    GD_CHECK(config.addNumberWithNotify(1, const_cast<char*>("0791112233"), 1, false));
+
+    // visible in transaction, not in EEPROM
+    GD_CHECK_EQ(config.getNumberIdxInStore(const_cast<char*>("0791112233")), 1);
+    GD_CHECK(strcmp(config.getStoreNumber(1), "0791112233") == 0);
+    GD_CHECK_EQ(config.getSignNumber(1), 1);
+    GD_CHECK_EQ(config.getEEPROMWrites(), writes);
+
+    config.abortConfig();
+
+    GD_CHECK_EQ(config.getNumberIdxInStore(const_cast<char*>("0791112233")), GPSDOG_CONF_NUMBER_STORE);
+    GD_CHECK(strcmp(config.getStoreNumber(1), "") == 0);
+    GD_CHECK_EQ(config.getEEPROMWrites(), writes);
+
+    ////
+    // Change notify
+    config.beginConfig();
+    config.setAlarmNotify(0, false);
+    GD_CHECK(!config.isAlarmNotifyOn(0));
+    config.abortConfig();
+    GD_CHECK(config.isAlarmNotifyOn(0));
+
+    ////
+    // RESET with abort
+    config.beginConfig();
+    config.cleanConfig();
+    GD_CHECK_EQ(config.getNumberIdxInStore(const_cast<char*>("0791234567")), GPSDOG_CONF_NUMBER_STORE);
+    GD_CHECK(!config.isAlarmNotifyOn(0));
+    config.abortConfig();
+
+    GD_CHECK_EQ(config.getNumberIdxInStore(const_cast<char*>("0791234567")), 0);
+    GD_CHECK_EQ(config.getEEPROMWrites(), writes);
+
+    ////
+    // RESET and a new number with commit
+    config.beginConfig();
+    config.cleanConfig();
+    config.addNumberWithNotify(1, const_cast<char*>("0791112233"), 1, true);
+    config.commitConfig();
+
+    GDConfig check;
+    check.loadConfig();
+
+    GD_CHECK(strcmp(check.getStoreNumber(0), "") == 0);
+    GD_CHECK(strcmp(check.getStoreNumber(1), "0791112233") == 0);
+    GD_CHECK(check.isAlarmNotifyOn(1));
+    GD_CHECK_EQ(check.getNumberIdxInStore(const_cast<char*>("+41791112233")), 1);
+}
+
+/**
+ * Fill the store and count the EEPROM reads of a lookup for a unknown
+ * number (like every SMS in protect mode) and for the last number.
+ */
+static void testCost()
+{
+    GDConfig    config;
+    char        num[GPSDOG_CONF_NUM_SIZE +1];
+    uint32_t    miss;
+    uint32_t    hit;
+    uint32_t    oldMiss;
+    uint32_t    oldHit;
+    uint32_t    maxMiss = 0;
+    uint32_t    maxHit  = 0;
+
+    EEPROM.erase();
+    config.loadConfig();
+
+    for (uint8_t i = 0; i < GPSDOG_CONF_NUMBER_STORE; i++) {
+        sprintf(num, "+417912345%02u", i);
+        GD_CHECK(config.addNumberWithNotify(i, num, 3, false));
+
+        ////
+        // Unknown
+        EEPROM.m_reads = 0;
+        GD_CHECK_EQ(config.getNumberIdxInStore(const_cast<char*>("0799999999")), GPSDOG_CONF_NUMBER_STORE);
+        miss = EEPROM.m_reads;
+
+        EEPROM.m_reads = 0;
+        GD_CHECK_EQ(oldLookup("0799999999"), GPSDOG_CONF_NUMBER_STORE);
+        oldMiss = EEPROM.m_reads;
+
+        ////
+        // Last number, with other prefix
+        sprintf(num, "07912345%02u", i);
+
+        EEPROM.m_reads = 0;
+        GD_CHECK_EQ(config.getNumberIdxInStore(num), i);
+        hit = EEPROM.m_reads;
+
+        EEPROM.m_reads = 0;
+        GD_CHECK_EQ(oldLookup(num), i);
+        oldHit = EEPROM.m_reads;
+
+        if (i == 0 || i == GPSDOG_CONF_NUMBER_STORE -1 || (i +1) % 4 == 0) {
+            printf("%2u numbers: unknown %u reads (old %3u), found %2u reads (old %3u)\n", i +1, miss, oldMiss, hit, oldHit);
+        }
+
+        if (miss > maxMiss) {
+            maxMiss = miss;
+        }
+        if (hit > maxHit) {
+            maxHit = hit;
+        }
+    }
+
+    // no EEPROM access for unknown, only the found number is read
+    GD_CHECK_EQ(maxMiss, 0);
+    GD_CHECK(maxHit <= GPSDOG_CONF_CONTACT_SIZE * 2);
+}
+
+int main()
+{
+    testSign();
+    testTransaction();
+    testCost();
+
+    return gdTestResult("test_contact");
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
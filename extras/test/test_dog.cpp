@@ -0,0 +1,227 @@
+
+// GPSDog with a fake clock and modem: tick() deadlines, alarm schedule and commands
+
+#include "dog.h"
+
+/**
+ * tick() do only the work they is due and return the next deadline.
+ */
+static void testDeadlines()
+{
+    GPSDog      dog;
+    uint32_t    ticks;
+
+    EEPROM.erase();
+    dogStart(&dog, 0);
+
+    // GPS and SMS poll at boot, next is the SMS poll
+    GD_CHECK_EQ(dog.tick(0), GPSDOG_WAIT_SMS);
+    GD_CHECK_EQ(s_checkCount, 1);
+    GD_CHECK_EQ(s_gpsCount, 1);
+
+    // before the deadline nothing is done
+    GD_CHECK_EQ(dog.tick(GPSDOG_WAIT_SMS / 2), GPSDOG_WAIT_SMS);
+    GD_CHECK_EQ(s_checkCount, 1);
+    GD_CHECK_EQ(s_gpsCount, 1);
+
+    // one tick per poll
+    g_millis = GPSDOG_WAIT_SMS;
+    ticks = dogRun(60000);
+
+    GD_CHECK_EQ(s_checkCount, 60);
+    GD_CHECK(ticks > 0 && ticks <= 60);
+
+    // ring indicator, poll only as fallback
+    dog.enableSMSSignal();
+    s_checkCount    = 0;
+    s_gpsCount      = 0;
+    ticks           = dogRun(60000 + 3600000UL);
+
+    GD_CHECK_EQ(s_checkCount, 3600000UL / GPSDOG_WAIT_SMS_SIGNAL);
+    GD_CHECK(s_gpsCount >= 3600000UL / GPSDOG_WAIT_GPS_MAX && s_gpsCount <= 3600000UL / GPSDOG_WAIT_GPS_MIN);
+    GD_CHECK(ticks > 0 && ticks <= s_checkCount + s_gpsCount + 3600000UL / GPSDOG_WAIT_PROCESSING);
+}
+
+/**
+ * A alarm interval of 0 is not allowed, else every tick send a alarm.
+ */
+static void testInterval()
+{
+    GPSDog      dog;
+    uint32_t    sends;
+
+    EEPROM.erase();
+    dogStart(&dog, 0);
+
+    dogCommand("INIT pw1234 " DOG_OWNER " 0 ON");
+    dogCommand("SET INTERVAL 0");
+    GD_CHECK(strcmp(s_outText, "System Error!") == 0);
+
+    dogCommand("SET INTERVAL abc");
+    GD_CHECK(strcmp(s_outText, "System Error!") == 0);
+
+    // one alarm in 10 min with the default interval
+    dogCommand("ALARM ON");
+    sends = s_sendCount;
+
+    GD_CHECK(dogRun(g_millis + 600000UL) > 0);
+    GD_CHECK_EQ(s_sendCount - sends, 1);
+}
+
+/**
+ * A alarm schedule is restored after a reset, but the receiver has no
+ * fix. The due alarm timer may not keep the loop busy.
+ */
+static void testRestoredAlarm()
+{
+    GPSDog      dog;
+    GPSDog      reset;
+    uint32_t    sends;
+
+    EEPROM.erase();
+    dogStart(&dog, 0);
+
+    dogCommand("INIT pw1234 " DOG_OWNER " 0 ON");
+    dogCommand("SET INTERVAL 1");
+    dogCommand("ALARM ON");
+
+    // first alarm after the fix
+    sends = s_sendCount;
+    dogRun(g_millis + 50000);
+    GD_CHECK_EQ(s_sendCount - sends, 1);
+
+    // reset, the receiver need time for a fix
+    dogStart(&reset, 0);
+    s_gpsFix = GPSDOG_GPS_FIX_NONE;
+
+    GD_CHECK(dogRun(GPSDOG_WAIT_GPSFIX - 10000) > 0);
+    GD_CHECK_EQ(s_sendCount, 0);
+
+    // alarm is send with the first fix
+    s_gpsFix = GPSDOG_GPS_FIX_3D;
+
+    GD_CHECK(dogRun(GPSDOG_WAIT_GPSFIX - 10000 + GPSDOG_WAIT_GPS_MIN) > 0);
+    GD_CHECK_EQ(s_sendCount, 1);
+}
+
+/**
+ * A fix they is rejected from the jump filter is not a good sample.
+ */
+static void testQualitySample()
+{
+    GPSDog      dog;
+    uint32_t    sends;
+
+    EEPROM.erase();
+    dogStart(&dog, 0);
+    s_gpsFix = GPSDOG_GPS_FIX_NONE;
+
+    dogCommand("INIT pw1234 " DOG_OWNER " 0 ON");
+    dogCommand("ALARM ON");
+    sends = s_sendCount;
+
+    // good samples with a jump of 111 km in 10 s
+    for (uint8_t i = 0; i < GPSDOG_GPS_QUALITY_SAMPLES; i++) {
+        g_millis += 10000;
+        dog.updateGPSData(i == GPSDOG_GPS_QUALITY_SAMPLES -1 ? DOG_LAT + 1000000 : DOG_LAT, DOG_LON, 0, GPSDOG_GPS_FIX_3D, 8, 100, s_date, s_time);
+    }
+
+    // no fix, no alarm
+    dogRun(g_millis + 1000);
+    GD_CHECK_EQ(s_sendCount - sends, 0);
+}
+
+/**
+ * After a failed retry the other due replies wait for the backoff, they
+ * are not send on the next ticks.
+ */
+static void testQueueBackoff()
+{
+    GPSDog      dog;
+    uint32_t    start;
+    uint32_t    sends;
+
+    EEPROM.erase();
+    dogStart(&dog, 0);
+
+    dogCommand("INIT pw1234 " DOG_OWNER " 0 OFF");
+
+    // 2 replies in queue
+    s_online = false;
+    start = g_millis;
+
+    dogCommand("STATUS");
+    dogCommand("VERSION");
+    sends = s_sendCount;
+
+    // first retry fails, the second reply wait
+    dogRun(start + GPSDOG_QUEUE_BACKOFF * 2);
+    GD_CHECK_EQ(s_sendCount - sends, 1);
+
+    // both are send after the network is back
+    s_online = true;
+    sends = s_sendCount;
+
+    dogRun(start + GPSDOG_QUEUE_BACKOFF * 8);
+    GD_CHECK_EQ(s_sendCount - sends, 2);
+}
+
+/**
+ * TRACK count is checked before it is cut to 8 bit.
+ */
+static void testTrackCount()
+{
+    GPSDog      dog;
+
+    EEPROM.erase();
+    dogStart(&dog, 0);
+
+    dogCommand("INIT pw1234 " DOG_OWNER " 0 OFF");
+
+    dogCommand("TRACK 257");
+    GD_CHECK(strcmp(s_outText, "System Error!") == 0);
+
+    dogCommand("TRACK 2");
+    GD_CHECK(strncmp(s_outText, "Track:", 6) == 0);
+}
+
+/**
+ * Every command is found over the first char index, also in lowercase.
+ */
+static void testCommands()
+{
+    GPSDog      dog;
+    const char  *known[]    = {"ALARM ?", "FORWARD ?", "POWER", "PROTECT ?", "SET UNIT KMH", "STATUS", "STOP",
+                               "STORE 1 SHOW", "TRACK", "VERSION", "WATCH ?", "ZONE 1 DEL", "status", "Zone 1 del"};
+    const char  *unknown[]  = {"ALARMS ?", "BARK", "STATE", "ZONES 1 DEL", "1 ALARM", "@LARM ?", "[ ?", "~"};
+
+    EEPROM.erase();
+    dogStart(&dog, 0);
+
+    dogCommand("INIT pw1234 " DOG_OWNER " 0 OFF");
+
+    for (uint8_t i = 0; i < sizeof(known) / sizeof(known[0]); i++) {
+        dogCommand(known[i]);
+        GD_CHECK(strcmp(s_outText, "Command unknown!") != 0);
+    }
+
+    for (uint8_t i = 0; i < sizeof(unknown) / sizeof(unknown[0]); i++) {
+        dogCommand(unknown[i]);
+        GD_CHECK(strcmp(s_outText, "Command unknown!") == 0);
+    }
+}
+
+int main()
+{
+    testDeadlines();
+    testInterval();
+    testRestoredAlarm();
+    testQualitySample();
+    testQueueBackoff();
+    testTrackCount();
+    testCommands();
+
+    return gdTestResult("test_dog");
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
@@ -0,0 +1,263 @@
+
+// GDFence zones, point-in-polygon edges and the bounding box prefilter
+
+#include "test.h"
+#include "GDFence.h"
+
+/** Random value (xorshift32) */
+static uint32_t s_seed = 1;
+
+static uint32_t getRandom()
+{
+    s_seed ^= s_seed << 13;
+    s_seed ^= s_seed >> 17;
+    s_seed ^= s_seed << 5;
+
+    return s_seed;
+}
+
+/**
+ * Parse a point from a string without '\0' at the end.
+ */
+static bool parsePoint(const char *str, uint8_t size, int32_t *lat, int32_t *lon)
+{
+    char buffer[32];
+
+    // garbage after the size
+    memset(buffer, '9', sizeof(buffer));
+    memcpy(buffer, str, size);
+
+    return GDGps::parseGeoPoint(buffer, size, lat, lon);
+}
+
+static void testParse()
+{
+    int32_t lat;
+    int32_t lon;
+
+    GD_CHECK(parsePoint("48.1,8.2", 8, &lat, &lon));
+    GD_CHECK_EQ(lat, 48100000);
+    GD_CHECK_EQ(lon, 8200000);
+
+    GD_CHECK(parsePoint("-33.8688,151.2093", 17, &lat, &lon));
+    GD_CHECK_EQ(lat, -33868800);
+    GD_CHECK_EQ(lon, 151209300);
+
+    // more digits as microdegrees are ignored
+    GD_CHECK(parsePoint("48.12345678,+8", 14, &lat, &lon));
+    GD_CHECK_EQ(lat, 48123456);
+    GD_CHECK_EQ(lon, 8000000);
+
+    // empty longitude
+    lon = 0x5555;
+    GD_CHECK(!parsePoint("48.1,", 5, &lat, &lon));
+    GD_CHECK(!parsePoint("48.1,8.2", 5, &lat, &lon));
+    GD_CHECK_EQ(lon, 0x5555);
+
+    GD_CHECK(!parsePoint("48.1,-", 6, &lat, &lon));
+    GD_CHECK(!parsePoint(",8.2", 4, &lat, &lon));
+    GD_CHECK(!parsePoint("48.1", 4, &lat, &lon));
+    GD_CHECK(!parsePoint("48.1;8.2", 8, &lat, &lon));
+    GD_CHECK(!parsePoint("48.1,8.2x", 9, &lat, &lon));
+    GD_CHECK(!parsePoint("48.1.1,8", 8, &lat, &lon));
+
+    // range
+    GD_CHECK(!parsePoint("90.000001,0", 11, &lat, &lon));
+    GD_CHECK(parsePoint("-90,-180", 8, &lat, &lon));
+    GD_CHECK(!parsePoint("0,180.1", 7, &lat, &lon));
+    GD_CHECK(!parsePoint("0,1800", 6, &lat, &lon));
+}
+
+/**
+ * Square and a concave polygon (L), with points on edges and vertices.
+ */
+static void testPolygon()
+{
+    GDFence fence;
+    int32_t lat[] = { 47000000, 47000000, 47100000, 47100000 };
+    int32_t lon[] = { 8000000, 8100000, 8100000, 8000000 };
+    int32_t lLat[] = { 47000000, 47000000, 47050000, 47050000, 47100000, 47100000 };
+    int32_t lLon[] = { 8000000, 8100000, 8100000, 8050000, 8050000, 8000000 };
+    uint8_t count;
+    uint8_t tests;
+
+    EEPROM.erase();
+    fence.loadFence();
+
+    GD_CHECK(!fence.isInFence(47050000, 8050000));
+    GD_CHECK(!fence.setFencePolygon(0, lat, lon, 2));
+    GD_CHECK(!fence.setFencePolygon(GPSDOG_FENCE_COUNT, lat, lon, 4));
+    GD_CHECK(fence.setFencePolygon(0, lat, lon, 4));
+
+    GD_CHECK(fence.isInFence(47050000, 8050000));
+    GD_CHECK(fence.isInFence(47000001, 8000001));
+    GD_CHECK(fence.isInFence(47099999, 8099999));
+    GD_CHECK(!fence.isInFence(47100001, 8050000));
+    GD_CHECK(!fence.isInFence(46999999, 8050000));
+    GD_CHECK(!fence.isInFence(47050000, 7999999));
+    GD_CHECK(!fence.isInFence(47050000, 8100001));
+
+    ////
+    // Shared edge of 2 squares, a point is in one of them
+    count = 0;
+    tests = 0;
+
+    for (int32_t i = 47000001; i < 47100000; i += 9999, tests++) {
+        bool left = fence.isInFence(i, 8100000);
+
+        lon[0] = lon[3] = 8100000;
+        lon[1] = lon[2] = 8200000;
+        fence.setFencePolygon(0, lat, lon, 4);
+
+        if (left != fence.isInFence(i, 8100000)) {
+            count++;
+        }
+
+        lon[0] = lon[3] = 8000000;
+        lon[1] = lon[2] = 8100000;
+        fence.setFencePolygon(0, lat, lon, 4);
+    }
+
+    GD_CHECK_EQ(count, tests);
+
+    // outside next to the vertices
+    GD_CHECK(!fence.isInFence(47000000, 8100001));
+    GD_CHECK(!fence.isInFence(46999999, 8000000));
+
+    ////
+    // Concave
+    GD_CHECK(fence.setFencePolygon(1, lLat, lLon, 6));
+    fence.delFence(0);
+
+    GD_CHECK(fence.isInFence(47025000, 8075000));
+    GD_CHECK(fence.isInFence(47075000, 8025000));
+    GD_CHECK(!fence.isInFence(47075000, 8075000));
+
+    // horizontal edge with the same latitude as the point
+    GD_CHECK(fence.isInFence(47050000, 8025000));
+    GD_CHECK(!fence.isInFence(47050000, 8075001) && fence.isInFence(47049999, 8075001));
+
+    // from EEPROM
+    GDFence reload;
+    reload.loadFence();
+    GD_CHECK(!reload.isInFence(47075000, 8075000));
+    GD_CHECK(reload.isInFence(47075000, 8025000));
+
+    // clean
+    reload.cleanFence();
+    GD_CHECK(!reload.isInFence(47075000, 8025000));
+}
+
+/**
+ * Circle with 100 m radius, 1 microdegree latitude is 0.111 m.
+ */
+static void testCircle()
+{
+    GDFence fence;
+
+    EEPROM.erase();
+    fence.loadFence();
+
+    GD_CHECK(!fence.setFenceCircle(0, 47000000, 8000000, 0));
+    GD_CHECK(fence.setFenceCircle(0, 47000000, 8000000, 100));
+
+    GD_CHECK(fence.isInFence(47000000, 8000000));
+    GD_CHECK(fence.isInFence(47000000 + 855, 8000000));
+    GD_CHECK(!fence.isInFence(47000000 + 945, 8000000));
+    GD_CHECK(fence.isInFence(47000000 - 855, 8000000));
+
+    // 100 m east is more microdegrees with cos(47°)
+    GD_CHECK(fence.isInFence(47000000, 8000000 + 1254));
+    GD_CHECK(!fence.isInFence(47000000, 8000000 + 1385));
+    GD_CHECK(!fence.isInFence(47000000 + 700, 8000000 + 1000));
+}
+
+/**
+ * Float reference for a polygon.
+ */
+static bool refPolygon(int32_t *lat, int32_t *lon, uint8_t count, int32_t pLat, int32_t pLon)
+{
+    bool inside = false;
+
+    for (uint8_t i = 0, y = count -1; i < count; y = i++) {
+        if ((lat[i] > pLat) != (lat[y] > pLat) && pLon < static_cast<double>(lon[y] - lon[i]) * (pLat - lat[i]) / (lat[y] - lat[i]) + lon[i]) {
+            inside = !inside;
+        }
+    }
+
+    return inside;
+}
+
+/**
+ * 4 random polygons in a 0.1° area, random fixes in a 1° area. Compare
+ * with the float reference and count the EEPROM reads with prefilter.
+ */
+static void testRandom()
+{
+    GDFence     fence;
+    int32_t     lat[GPSDOG_FENCE_COUNT][GPSDOG_FENCE_POINTS];
+    int32_t     lon[GPSDOG_FENCE_COUNT][GPSDOG_FENCE_POINTS];
+    int32_t     pLat;
+    int32_t     pLon;
+    uint32_t    fails   = 0;
+    uint32_t    inside  = 0;
+    uint32_t    tests   = 20000;
+    bool        ref;
+
+    EEPROM.erase();
+    fence.loadFence();
+
+    for (uint8_t z = 0; z < GPSDOG_FENCE_COUNT; z++) {
+        for (uint8_t i = 0; i < GPSDOG_FENCE_POINTS; i++) {
+            lat[z][i] = 47000000 + getRandom() % 100000;
+            lon[z][i] = 8000000 + getRandom() % 100000;
+        }
+
+        GD_CHECK(fence.setFencePolygon(z, lat[z], lon[z], GPSDOG_FENCE_POINTS));
+    }
+
+    EEPROM.m_reads = 0;
+
+    for (uint32_t t = 0; t < tests; t++) {
+        // 1 of 10 near the zones
+        if (t % 10 == 0) {
+            pLat = 47000000 + getRandom() % 100000;
+            pLon = 8000000 + getRandom() % 100000;
+        }
+        else {
+            pLat = 46500000 + getRandom() % 1000000;
+            pLon = 7500000 + getRandom() % 1000000;
+        }
+
+        ref = false;
+
+        for (uint8_t z = 0; z < GPSDOG_FENCE_COUNT; z++) {
+            ref = ref || refPolygon(lat[z], lon[z], GPSDOG_FENCE_POINTS, pLat, pLon);
+        }
+
+        if (fence.isInFence(pLat, pLon) != ref) {
+            fails++;
+        }
+        if (ref) {
+            inside++;
+        }
+    }
+
+    printf("%u random fixes: %u inside, %u differ, %.1f EEPROM reads per fix (without prefilter %u)\n", tests, inside, fails, static_cast<double>(EEPROM.m_reads) / tests, static_cast<unsigned>(GPSDOG_FENCE_COUNT * sizeof(GD_FENCE_ZONE)));
+
+    GD_CHECK(inside > 100);
+    GD_CHECK_EQ(fails, 0);
+    GD_CHECK(EEPROM.m_reads / tests < sizeof(GD_FENCE_ZONE));
+}
+
+int main()
+{
+    testParse();
+    testPolygon();
+    testCircle();
+    testRandom();
+
+    return gdTestResult("test_fence");
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
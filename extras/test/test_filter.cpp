@@ -0,0 +1,245 @@
+
+// GDFilter jump filter, median and outside confirm with a replayed trace
+
+#include <math.h>
+
+#include "test.h"
+#include "GDFilter.h"
+
+// watch point
+#define WATCH_LAT 47000000
+#define WATCH_LON 8000000
+#define WATCH_RADIUS 100
+
+// meters per microdegree latitude
+#define METER 0.111195
+
+/** Random value (xorshift32) */
+static uint32_t s_seed = 1;
+
+static uint32_t getRandom()
+{
+    s_seed ^= s_seed << 13;
+    s_seed ^= s_seed >> 17;
+    s_seed ^= s_seed << 5;
+
+    return s_seed;
+}
+
+/**
+ * Move a point some meters north and east.
+ */
+static void movePoint(int32_t *lat, int32_t *lon, double north, double east)
+{
+    *lat += lround(north / METER);
+    *lon += lround(east / (METER * cos(*lat / 1000000.0 * M_PI / 180.0)));
+}
+
+/**
+ * Parked fix with noise of +/- 10 m and sometimes a multipath jump of
+ * 150 - 600 m, for one or two fixes.
+ */
+static void parkedFix(int32_t *lat, int32_t *lon, uint8_t *burst)
+{
+    double dist;
+    double angle;
+
+    *lat = WATCH_LAT;
+    *lon = WATCH_LON;
+
+    movePoint(lat, lon, static_cast<int32_t>(getRandom() % 21) - 10, static_cast<int32_t>(getRandom() % 21) - 10);
+
+    if (*burst == 0 && getRandom() % 100 < 2) {
+        *burst = getRandom() % 4 == 0 ? 2 : 1;
+    }
+
+    if (*burst > 0) {
+        (*burst)--;
+
+        dist    = 150 + getRandom() % 450;
+        angle   = (getRandom() % 360) * M_PI / 180.0;
+
+        movePoint(lat, lon, dist * cos(angle), dist * sin(angle));
+    }
+}
+
+/** Result of a replay */
+struct Replay
+{
+    uint32_t m_falseAlarms;
+    uint32_t m_rejected;
+    uint32_t m_theftFixes;
+};
+
+/**
+ * Replay 24 h parked with a fix every 10 sec, then the car is driven
+ * away with 50 km/h. A alarm while parked is false, it is stopped and
+ * the watch set again like STOP & WATCH ON.
+ */
+static Replay replay(uint16_t maxSpeed, uint8_t median, uint8_t confirm)
+{
+    GDFilter    filter;
+    Replay      result   = { 0, 0, 0 };
+    uint16_t    watchCos = GDGps::getCosLatitude(WATCH_LAT);
+    uint32_t    now      = 0;
+    uint8_t     burst    = 0;
+    int32_t     lat;
+    int32_t     lon;
+    int32_t     carLat   = WATCH_LAT;
+    int32_t     carLon   = WATCH_LON;
+    bool        outside;
+
+    s_seed = 7;
+
+    for (uint32_t i = 0; i < 8640 + 200; i++, now += 10000) {
+        ////
+        // Parked / driving
+        if (i < 8640) {
+            parkedFix(&lat, &lon, &burst);
+        }
+        else {
+            movePoint(&carLat, &carLon, 139, 0);
+            lat = carLat;
+            lon = carLon;
+        }
+
+        if (!filter.filterFix(&lat, &lon, now, maxSpeed, median)) {
+            result.m_rejected++;
+            continue;
+        }
+
+        outside = !GDGps::isInRadius(WATCH_LAT, WATCH_LON, watchCos, lat, lon, WATCH_RADIUS);
+
+        if (!filter.confirmOutside(outside, confirm)) {
+            continue;
+        }
+
+        if (i < 8640) {
+            result.m_falseAlarms++;
+            filter.resetOutside();
+        }
+        else {
+            result.m_theftFixes = i - 8640 +1;
+            break;
+        }
+    }
+
+    printf("speed %3u, median %u, confirm %u: %3u false alarms in 24 h, %3u fixes rejected, theft alarm after %u fixes\n", maxSpeed, median, confirm, result.m_falseAlarms, result.m_rejected, result.m_theftFixes);
+
+    return result;
+}
+
+/**
+ * A single jump is rejected by the speed check.
+ */
+static void testSpeed()
+{
+    GDFilter    filter;
+    int32_t     lat = WATCH_LAT;
+    int32_t     lon = WATCH_LON;
+
+    GD_CHECK(filter.filterFix(&lat, &lon, 0, 100, 1));
+
+    // 500 m in 1 sec
+    movePoint(&lat, &lon, 500, 0);
+    GD_CHECK(!filter.filterFix(&lat, &lon, 1000, 100, 1));
+
+    // back is okay
+    lat = WATCH_LAT;
+    lon = WATCH_LON;
+    GD_CHECK(filter.filterFix(&lat, &lon, 2000, 100, 1));
+
+    // 25 m is slack
+    movePoint(&lat, &lon, 25, 0);
+    GD_CHECK(filter.filterFix(&lat, &lon, 2100, 100, 1));
+
+    // after some rejects the position is the new start
+    movePoint(&lat, &lon, 5000, 0);
+
+    for (uint8_t i = 0; i < GPSDOG_FILTER_REJECT_MAX; i++) {
+        GD_CHECK(!filter.filterFix(&lat, &lon, 3000 + i * 1000, 100, 1));
+    }
+
+    GD_CHECK(filter.filterFix(&lat, &lon, 9000, 100, 1));
+}
+
+/**
+ * Median of 3 remove a single jump.
+ */
+static void testMedian()
+{
+    GDFilter    filter;
+    int32_t     lat;
+    int32_t     lon;
+
+    for (uint8_t i = 0; i < 4; i++) {
+        lat = WATCH_LAT + i;
+        lon = WATCH_LON;
+
+        // jump on the third fix
+        if (i == 2) {
+            lat += 50000;
+        }
+
+        GD_CHECK(filter.filterFix(&lat, &lon, i * 10000, 0, 3));
+
+        // window 0, 1, jump
+        if (i == 2) {
+            GD_CHECK_EQ(lat, WATCH_LAT + 1);
+            GD_CHECK_EQ(lon, WATCH_LON);
+        }
+    }
+
+    GD_CHECK_EQ(lat, WATCH_LAT + 3);
+}
+
+/**
+ * Outside fixes in a row, cleared by a inside fix or a new watch point.
+ */
+static void testConfirm()
+{
+    GDFilter filter;
+
+    GD_CHECK(!filter.confirmOutside(true, 3));
+    GD_CHECK(!filter.confirmOutside(true, 3));
+    GD_CHECK(!filter.confirmOutside(false, 3));
+    GD_CHECK(!filter.confirmOutside(true, 3));
+    GD_CHECK(!filter.confirmOutside(true, 3));
+    GD_CHECK(filter.confirmOutside(true, 3));
+
+    // count of the old watch point is still there
+    GD_CHECK(filter.confirmOutside(true, 3));
+
+    // WATCH ON / STOP
+    filter.resetOutside();
+    GD_CHECK(!filter.confirmOutside(true, 2));
+    GD_CHECK(filter.confirmOutside(true, 2));
+}
+
+static void testReplay()
+{
+    Replay raw      = replay(0, 1, 1);
+    Replay def      = replay(GPSDOG_FILTER_SPEED_DEF, GPSDOG_FILTER_MEDIAN_DEF, GPSDOG_FILTER_CONFIRM_DEF);
+    Replay strong   = replay(100, 3, 3);
+
+    GD_CHECK(raw.m_falseAlarms > 100);
+    GD_CHECK(def.m_falseAlarms < raw.m_falseAlarms / 4);
+    GD_CHECK(strong.m_falseAlarms < def.m_falseAlarms / 10);
+
+    // the theft is found in less as 2 min
+    GD_CHECK(raw.m_theftFixes > 0 && raw.m_theftFixes <= 12);
+    GD_CHECK(def.m_theftFixes > 0 && def.m_theftFixes <= 12);
+    GD_CHECK(strong.m_theftFixes > 0 && strong.m_theftFixes <= 12);
+}
+
+int main()
+{
+    testSpeed();
+    testMedian();
+    testConfirm();
+    testReplay();
+
+    return gdTestResult("test_filter");
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
@@ -0,0 +1,327 @@
+
+// Fixed point GPS data: radius check against haversine, soft float calls
+// and host time of updateGPSData and the status text against the old
+// double path
+
+#include <chrono>
+
+#include "dog.h"
+
+// runs for the time
+#define RUNS 200000
+
+/** Result of the runs, the compiler can't remove them */
+static volatile uint32_t s_sink = 0;
+
+/**
+ * Nanoseconds of the host clock.
+ */
+static uint64_t getNanos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/** Random value (xorshift32) */
+static uint32_t s_seed = 1;
+
+static uint32_t getRandom()
+{
+    s_seed ^= s_seed << 13;
+    s_seed ^= s_seed >> 17;
+    s_seed ^= s_seed << 5;
+
+    return s_seed;
+}
+
+/**
+ * Distance in meters with haversine.
+ */
+static double getHaversine(int32_t lat0, int32_t lon0, int32_t lat, int32_t lon)
+{
+    double p0   = lat0 / 1000000.0 * M_PI / 180.0;
+    double p1   = lat / 1000000.0 * M_PI / 180.0;
+    double dLat = p1 - p0;
+    double dLon = (lon - lon0) / 1000000.0 * M_PI / 180.0;
+    double a    = sin(dLat / 2) * sin(dLat / 2) + cos(p0) * cos(p1) * sin(dLon / 2) * sin(dLon / 2);
+
+    return 6371000.0 * 2 * atan2(sqrt(a), sqrt(1 - a));
+}
+
+/**
+ * Radius check against haversine, from the equator to 70° and over 180°.
+ * A other result is only allowed near the edge, the meters of every axis
+ * are cut to integer.
+ */
+static void testRadius()
+{
+    uint16_t    radius[]    = {10, 50, 200, 1000, 40000};
+    uint32_t    cases       = 0;
+    uint32_t    others      = 0;
+    uint32_t    fails       = 0;
+
+    for (int32_t lat0 = -70000000; lat0 <= 70000000; lat0 += 10000000) {
+        int32_t     lon0    = lat0 == 0 ? 179999000 : 8000000;
+        uint16_t    cosLat  = GDGps::getCosLatitude(lat0);
+
+        for (uint8_t i = 0; i < 200; i++, cases++) {
+            uint16_t    r       = radius[i % 5];
+            // up to 2x radius in microdegrees, the longitude scaled
+            int32_t     range   = r * 18L;
+            int32_t     lat     = lat0 + static_cast<int32_t>(getRandom() % (2 * range + 1)) - range;
+            int32_t     lon     = lon0 + (static_cast<int32_t>(getRandom() % (2 * range + 1)) - range) * GPSDOG_GPS_COS_ONE / cosLat;
+            double      dist    = getHaversine(lat0, lon0, lat, lon);
+
+            // over 180°
+            if (lon > 180000000) {
+                lon -= 360000000;
+            }
+
+            if (GDGps::isInRadius(lat0, lon0, cosLat, lat, lon, r) != (dist <= r)) {
+                others++;
+
+                // 2% and the cut meters of both axes
+                if (fabs(dist - r) > r * 0.02 + 2.0) {
+                    fails++;
+                }
+            }
+        }
+    }
+
+    printf("radius: %u cases against haversine, %u other results near the edge, %u over 2%% + 2 m\n", cases, others, fails);
+    GD_CHECK_EQ(fails, 0);
+}
+
+/** Soft float library calls of the old path on the AVR */
+static uint32_t s_floatCalls = 0;
+
+/**
+ * double they count the operations, on the AVR every operation is a call
+ * of the soft float library.
+ */
+struct Soft
+{
+    double v;
+
+    Soft(double val = 0.0) : v(val) {}
+
+    Soft operator-(const Soft &o) const { s_floatCalls++; return Soft(v - o.v); }
+    Soft operator*(const Soft &o) const { s_floatCalls++; return Soft(v * o.v); }
+    bool operator<(const Soft &o) const { s_floatCalls++; return v < o.v; }
+    bool operator==(const Soft &o) const { s_floatCalls++; return v == o.v; }
+};
+
+/**
+ * dtostrf of avr-libc.
+ */
+static char* oldDtostrf(Soft val, int8_t width, uint8_t prec, char *buffer)
+{
+    s_floatCalls++;
+    sprintf(buffer, "%*.*f", width, prec, val.v);
+
+    return buffer;
+}
+
+/**
+ * Old GPS data with double and the old watch check of GPSDog.
+ */
+class OldGps
+{
+    public:
+
+        Soft    m_latitude;
+        Soft    m_longitude;
+        Soft    m_speed;
+        Soft    m_storeLat;
+        Soft    m_storeLon;
+        Soft    m_geoFix;
+        char    m_date[GPSDOG_GPS_DATE_SIZE +1];
+        char    m_time[GPSDOG_GPS_TIME_SIZE +1];
+        char    m_message[161];
+        bool    m_alarm;
+
+        OldGps() {
+            memset(m_date, 0x00, sizeof(m_date));
+            memset(m_time, 0x00, sizeof(m_time));
+            memset(m_message, 0x00, sizeof(m_message));
+
+            m_storeLat  = DOG_LAT / 1000000.0;
+            m_storeLon  = DOG_LON / 1000000.0;
+            m_geoFix    = 0.001;
+            m_alarm     = false;
+        }
+
+        static bool cmpGeoData(Soft a, Soft b, Soft geoFix) {
+            Soft val = a - b;
+
+            // negative
+            if (val < 0.0) {
+                val = val * -1.0;
+            }
+
+            return val < geoFix || val == 0.0;
+        }
+
+        static uint8_t removeSpace(char *buffer, uint8_t size) {
+            uint8_t start = 0;
+
+            while (buffer[start] == 0x20) {
+                start++;
+            }
+
+            memmove(buffer, buffer + start, size - start);
+
+            return strlen(buffer);
+        }
+
+        void updateGPSData(Soft latitude, Soft longitude, Soft speed, char *date, char *time) {
+            m_latitude  = latitude;
+            m_longitude = longitude;
+            m_speed     = speed * 1.6;
+
+            strncpy(m_date, date, GPSDOG_GPS_DATE_SIZE);
+            strncpy(m_time, time, GPSDOG_GPS_TIME_SIZE);
+
+            // watch
+            if (!cmpGeoData(m_storeLat, latitude, m_geoFix) || !cmpGeoData(m_storeLon, longitude, m_geoFix)) {
+                m_alarm = true;
+            }
+        }
+
+        void createStatusSMS() {
+            char lat[12];
+            char lon[12];
+            char speed[7];
+
+            memset(lat, 0x00, sizeof(lat));
+            memset(lon, 0x00, sizeof(lon));
+            memset(speed, 0x00, sizeof(speed));
+
+            removeSpace(oldDtostrf(m_latitude, 11, 6, lat), sizeof(lat));
+            removeSpace(oldDtostrf(m_longitude, 11, 6, lon), sizeof(lon));
+            removeSpace(oldDtostrf(m_speed, 6, 2, speed), sizeof(speed));
+
+            snprintf(m_message, sizeof(m_message) -1, GPSDOG_SMS_STATUS, "Watch", lat, lon, speed, m_date, m_time, lat, lon);
+        }
+};
+
+/**
+ * GPS data in fixed point with the status text of GPSDog.
+ */
+class NewGps : public GDGps
+{
+    public:
+
+        char    m_message[161];
+
+        void createStatusSMS() {
+            char lat[12];
+            char lon[12];
+            char speed[7];
+
+            this->getLatitude(lat, 12);
+            this->getLongitude(lon, 12);
+            this->getSpeed(speed, 7);
+
+            snprintf(m_message, sizeof(m_message) -1, GPSDOG_SMS_STATUS, "Watch", lat, lon, speed, m_date, m_time, lat, lon);
+        }
+};
+
+/**
+ * Soft float calls and host time per call. The host has a FPU, so the
+ * host time of the old path is much to short for the AVR. There every
+ * double operation and dtostrf is a call of the soft float library.
+ */
+static void testBench()
+{
+    GPSDog      dog;
+    OldGps      oldGps;
+    NewGps      newGps;
+    uint64_t    start;
+    double      oldUpdate;
+    double      newUpdate;
+    double      oldStatus;
+    double      newStatus;
+    uint32_t    updateCalls;
+    uint32_t    statusCalls;
+    int32_t     lat;
+
+    ////
+    // GPSDog in watch mode with a fix
+    EEPROM.erase();
+    dogStart(&dog, 0);
+
+    dogCommand("INIT pw1234 " DOG_OWNER " 0 OFF");
+    dogRun(g_millis + GPSDOG_WAIT_GPS_MIN * GPSDOG_GPS_QUALITY_SAMPLES);
+    dogCommand("WATCH ON");
+
+    ////
+    // updateGPSData, jitter in the watch radius
+    start = getNanos();
+
+    for (uint32_t run = 0; run < RUNS; run++) {
+        lat = DOG_LAT + (run & 0x3F);
+        oldGps.updateGPSData(lat / 1000000.0, DOG_LON / 1000000.0, 0.5, s_date, s_time);
+    }
+
+    oldUpdate   = static_cast<double>(getNanos() - start) / RUNS;
+    updateCalls = s_floatCalls / RUNS;
+    start       = getNanos();
+
+    for (uint32_t run = 0; run < RUNS; run++) {
+        g_millis += 1000;
+        dog.updateGPSData(static_cast<int32_t>(DOG_LAT + (run & 0x3F)), static_cast<int32_t>(DOG_LON), 50, s_date, s_time);
+    }
+
+    newUpdate = static_cast<double>(getNanos() - start) / RUNS;
+
+    GD_CHECK(!oldGps.m_alarm);
+    GD_CHECK_EQ(s_sendCount, 2);
+
+    ////
+    // status text
+    newGps.m_latitude   = 47123456;
+    newGps.m_longitude  = -8654321;
+    newGps.m_speed      = 12345;
+    newGps.copyDateTime(s_date, s_time);
+
+    oldGps.m_latitude   = 47.123456;
+    oldGps.m_longitude  = -8.654321;
+    oldGps.m_speed      = 123.45;
+
+    s_floatCalls    = 0;
+    start           = getNanos();
+
+    for (uint32_t run = 0; run < RUNS; run++) {
+        oldGps.createStatusSMS();
+        s_sink += oldGps.m_message[20];
+    }
+
+    oldStatus   = static_cast<double>(getNanos() - start) / RUNS;
+    statusCalls = s_floatCalls / RUNS;
+    start       = getNanos();
+
+    for (uint32_t run = 0; run < RUNS; run++) {
+        newGps.createStatusSMS();
+        s_sink += newGps.m_message[20];
+    }
+
+    newStatus = static_cast<double>(getNanos() - start) / RUNS;
+
+    // same text
+    GD_CHECK(strcmp(oldGps.m_message, newGps.m_message) == 0);
+
+    printf("updateGPSData: old %2u soft float calls %4.0f ns, new 0 soft float calls %4.0f ns (with filter and track)\n", updateCalls, oldUpdate, newUpdate);
+    printf("status text:   old %2u soft float calls %4.0f ns, new 0 soft float calls %4.0f ns\n", statusCalls, oldStatus, newStatus);
+
+    GD_CHECK(updateCalls > 0 && statusCalls > 0);
+}
+
+int main()
+{
+    testRadius();
+    testBench();
+
+    return gdTestResult("test_gps");
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
@@ -0,0 +1,200 @@
+
+// Adaptive GPS period: GPS calls per day and theft detection latency on
+// traces of a parked and a moved vehicle, against a fixed 30 sec period
+
+#include "dog.h"
+
+// old fixed period
+#define FIXED_PERIOD 30000
+
+// GPS noise while parked, +/- 10 m in 1/1000000 degree
+#define NOISE 90
+
+// thefts per speed
+#define THEFTS 10
+
+/** Random value (xorshift32) */
+static uint32_t s_seed = 1;
+
+static uint32_t getRandom()
+{
+    s_seed ^= s_seed << 13;
+    s_seed ^= s_seed >> 17;
+    s_seed ^= s_seed << 5;
+
+    return s_seed;
+}
+
+/** Start of the move, 0 is parked */
+static uint32_t s_moveStart = 0;
+
+/** Speed of the move in m/s */
+static uint32_t s_moveSpeed = 0;
+
+/**
+ * Position of the trace at a time: noise of the receiver and the way to
+ * north after the move start.
+ *
+ * @param now               Millis value
+ * @param lat               Latitude
+ * @param lon               Longitude
+ */
+static void getTrace(uint32_t now, int32_t *lat, int32_t *lon)
+{
+    uint32_t hash = now / 1000 * 2654435761UL;
+
+    *lat = DOG_LAT + static_cast<int32_t>((hash >> 8) % (2 * NOISE +1)) - NOISE;
+    *lon = DOG_LON + static_cast<int32_t>((hash >> 20) % (2 * NOISE +1)) - NOISE;
+
+    // 1 m is 9 in 1/1000000 degree
+    if (s_moveStart != 0 && GDTimer::isReached(s_moveStart, now)) {
+        *lat += (now - s_moveStart) / 1000 * s_moveSpeed * 9;
+    }
+}
+
+/**
+ * Run the GPSDog on the trace until a time or the first alarm.
+ *
+ * @param until             Millis value to stop
+ * @return                  Millis value of the alarm or 0
+ */
+static uint32_t runTrace(uint32_t until)
+{
+    uint32_t sends = s_sendCount;
+
+    while (!GDTimer::isReached(until, g_millis)) {
+        getTrace(g_millis, &s_gpsLat, &s_gpsLon);
+        dogRun(g_millis + 1000);
+
+        if (s_sendCount != sends) {
+            return s_outTime;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Alarm time of the old fixed period with the same confirm and radius.
+ *
+ * @param start             Millis value of WATCH ON
+ * @return                  Millis value of the alarm
+ */
+static uint32_t getFixedAlarm(uint32_t start)
+{
+    int32_t     lat;
+    int32_t     lon;
+    uint16_t    cosLat  = GDGps::getCosLatitude(DOG_LAT);
+    uint8_t     outside = 0;
+
+    for (uint32_t now = start; ; now += FIXED_PERIOD) {
+        getTrace(now, &lat, &lon);
+
+        if (GDGps::isInRadius(DOG_LAT, DOG_LON, cosLat, lat, lon, GPSDOG_GPS_RADIUS_DEF)) {
+            outside = 0;
+        }
+        else if (++outside >= GPSDOG_FILTER_CONFIRM_DEF) {
+            return now;
+        }
+    }
+}
+
+/**
+ * Start a GPSDog with a fix in watch mode.
+ *
+ * @param dog               GPSDog of the test
+ * @return                  Millis value of WATCH ON
+ */
+static uint32_t startWatch(GPSDog *dog)
+{
+    EEPROM.erase();
+    dogStart(dog, 0);
+    dog->enableSMSSignal();
+
+    s_moveStart = 0;
+    getTrace(0, &s_gpsLat, &s_gpsLon);
+
+    dogCommand("INIT pw1234 " DOG_OWNER " 0 ON", true);
+    runTrace(GPSDOG_WAIT_GPS_MIN * GPSDOG_GPS_QUALITY_SAMPLES);
+
+    // watch zone on the parked place
+    s_gpsLat = DOG_LAT;
+    s_gpsLon = DOG_LON;
+    dogRun(g_millis + GPSDOG_WAIT_GPS_MAX);
+    dogCommand("WATCH ON", true);
+
+    s_gpsCount = 0;
+
+    return g_millis;
+}
+
+/**
+ * A parked day, the GPS is not asked all 30 sec.
+ */
+static void testParked()
+{
+    GPSDog      dog;
+    uint32_t    start;
+
+    start = startWatch(&dog);
+
+    GD_CHECK_EQ(runTrace(start + 86400000UL), 0);
+
+    printf("parked 24 h: %u GPS calls (fixed %u)\n", s_gpsCount, static_cast<unsigned>(86400000UL / FIXED_PERIOD));
+
+    GD_CHECK(s_gpsCount <= 86400000UL / GPSDOG_WAIT_GPS_MAX + 10);
+}
+
+/**
+ * Thefts after a random parked time, the alarm is not much later as with
+ * the fixed period.
+ *
+ * @param speed             Speed of the theft in m/s
+ */
+static void testTheft(uint32_t speed)
+{
+    uint32_t    start;
+    uint32_t    alarm;
+    uint32_t    latency;
+    uint32_t    fixed;
+    uint32_t    sum         = 0;
+    uint32_t    fixedSum    = 0;
+    uint32_t    max         = 0;
+    uint32_t    fixedMax    = 0;
+
+    for (uint8_t i = 0; i < THEFTS; i++) {
+        GPSDog dog;
+
+        start       = startWatch(&dog);
+        s_moveSpeed = speed;
+        s_moveStart = start + 3600000UL + getRandom() % (5 * 3600000UL);
+
+        alarm       = runTrace(s_moveStart + 3600000UL);
+        latency     = alarm - s_moveStart;
+        fixed       = getFixedAlarm(start) - s_moveStart;
+
+        GD_CHECK(alarm != 0);
+
+        sum         += latency;
+        fixedSum    += fixed;
+        max         = latency > max ? latency : max;
+        fixedMax    = fixed > fixedMax ? fixed : fixedMax;
+    }
+
+    printf("theft %2u km/h: alarm after mean %3u s, max %3u s (fixed mean %3u s, max %3u s)\n", static_cast<unsigned>(speed * 36 / 10),
+        sum / THEFTS / 1000, max / 1000, fixedSum / THEFTS / 1000, fixedMax / 1000);
+
+    // one long period more as fixed
+    GD_CHECK(max <= fixedMax + GPSDOG_WAIT_GPS_MAX);
+}
+
+int main()
+{
+    testParked();
+    testTheft(8);
+    testTheft(1);
+
+    return gdTestResult("test_period");
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
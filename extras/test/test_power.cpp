@@ -0,0 +1,187 @@
+
+// GDPower sleep accounting with watchdog and other wake ups
+
+#include <math.h>
+
+#include "test.h"
+#include "GDPower.h"
+#include "GDTimer.h"
+
+// one week in millis
+#define WEEK 604800000ULL
+
+/** Real time of the simulation in ms */
+static uint64_t s_real      = 0;
+
+/** Random wake up by a other interrupt, 0 is never */
+static uint32_t s_ringEvery = 0;
+static uint32_t s_seed      = 1;
+
+/** Sleep time they end with a other interrupt and count of it */
+static uint64_t s_ringSleep = 0;
+static uint32_t s_rings     = 0;
+
+/** Calls of the own watchdog ISR */
+static uint32_t s_ownISR    = 0;
+
+/** Nominal watchdog periods like GDPower */
+static const uint16_t s_wdtTime[] = {
+    16, 32, 64, 125, 250, 500, 1000, 2000, 4000, 8000
+};
+
+/**
+ * Period of the watchdog they GDPower start.
+ */
+static uint16_t getWDTPeriod()
+{
+    uint8_t bits = WDTCSR & (_BV(WDP3) | _BV(WDP2) | _BV(WDP1) | _BV(WDP0));
+
+    return s_wdtTime[(bits & 0x07) | ((bits & _BV(WDP3)) ? 0x08 : 0x00)];
+}
+
+/**
+ * Random value (xorshift32).
+ */
+static uint32_t getRandom()
+{
+    s_seed ^= s_seed << 13;
+    s_seed ^= s_seed >> 17;
+    s_seed ^= s_seed << 5;
+
+    return s_seed;
+}
+
+/**
+ * Own watchdog ISR like in a sketch, it replace the weak one of GDPower.
+ */
+ISR(WDT_vect)
+{
+    s_ownISR++;
+    GDPower::wakeWDT();
+}
+
+/**
+ * Sleep of the simulated MCU. It wake up after the watchdog period or
+ * earlier by a other interrupt.
+ */
+static void sleepHook()
+{
+    uint16_t period = getWDTPeriod();
+    uint32_t part;
+
+    if (s_ringEvery > 0) {
+        // ring in this period
+        if (getRandom() % s_ringEvery < period) {
+            part        = getRandom() % period;
+            s_real      += part;
+            s_ringSleep += part;
+            s_rings++;
+            return;
+        }
+    }
+
+    s_real += period;
+    WDT_vect();
+}
+
+/**
+ * One sleep with a watchdog and one with a early wake up.
+ */
+static void testSleep()
+{
+    GDPower     power;
+    uint32_t    start;
+
+    g_sleepHook = sleepHook;
+    s_ringEvery = 0;
+
+    start = power.getTime();
+    GD_CHECK(power.sleepFor(10000));
+    GD_CHECK_EQ(power.getTime() - start, 8000);
+
+    // to short for sleeping
+    start = power.getTime();
+    GD_CHECK(!power.sleepFor(10));
+    GD_CHECK_EQ(power.getTime() - start, 0);
+
+    // the sketch ISR is used
+    GD_CHECK_EQ(s_ownISR, 1);
+
+    // other interrupt
+    g_sleepHook = NULL;
+
+    start = power.getTime();
+    GD_CHECK(power.sleepFor(1000));
+    GD_CHECK_EQ(power.getTime() - start, 500);
+}
+
+/**
+ * A idle week with 30 sec deadlines and a ring every 2 min. The clock
+ * need to follow the real time.
+ *
+ * The sleep before a ring is not known, the timer 0 stop in power down.
+ * The half period is the guess, the error of a ring is random in +/- half
+ * period and has no bias. So the drift is a random walk of the rings, it
+ * grow with the root of the rings and not with the time. The watchdog
+ * oscillator has a tolerance of +/- 10 %, that is much more.
+ */
+static void testDrift()
+{
+    GDPower     power;
+    uint32_t    next;
+    uint32_t    now;
+    int64_t     drift;
+    double      sigma;
+
+    g_sleepHook = sleepHook;
+    s_ringEvery = 120000;
+    s_real      = 0;
+    s_rings     = 0;
+    g_millis    = 0;
+
+    now     = power.getTime();
+    next    = now + 30000;
+
+    while (s_real < WEEK) {
+        // wait like GPSDog::mainProcessing
+        if (!GDTimer::isReached(next, now)) {
+            power.sleepFor(next - now);
+        }
+        else {
+            next += 30000;
+        }
+
+        // awake for 5 ms
+        g_millis    += 5;
+        s_real      += 5;
+        now         = power.getTime();
+    }
+
+    drift = static_cast<int64_t>(now) - static_cast<int64_t>(s_real);
+
+    // random walk, a ring is uniform in a 8 s period
+    sigma = sqrt(s_rings) * 8000 / sqrt(12);
+
+    printf("1 week idle with %u rings: clock drift %lld ms (%.3f %%, sigma %.0f ms), %llu ms sleep before a ring\n", s_rings,
+        static_cast<long long>(drift), drift * 100.0 / s_real, sigma, static_cast<unsigned long long>(s_ringSleep));
+
+    // without a guess the clock lose all sleep before a ring
+    GD_CHECK(s_ringSleep > WEEK / 50);
+    GD_CHECK(drift > -3 * sigma && drift < 3 * sigma);
+
+    // max 0.1 % of the time, the watchdog itself is +/- 10 %
+    GD_CHECK(drift > -static_cast<int64_t>(WEEK / 1000) && drift < static_cast<int64_t>(WEEK / 1000));
+    GD_CHECK(power.getSleepTime() > WEEK / 1000 * 97 / 100);
+
+    g_sleepHook = NULL;
+}
+
+int main()
+{
+    testSleep();
+    testDrift();
+
+    return gdTestResult("test_power");
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
@@ -0,0 +1,176 @@
+
+// GDQueue retry, backoff and alarm priority
+
+#include "test.h"
+#include "GDQueue.h"
+
+// message kinds, like GPSDOG_OPT_SMS_*
+#define KIND_DONE 0x01
+#define KIND_STATUS 0x07
+
+/**
+ * Retry with doubled wait until the entry is given up.
+ */
+static void testBackoff()
+{
+    GDQueue     queue;
+    uint32_t    now     = 0xFFFFF000;
+    uint32_t    wait    = GPSDOG_QUEUE_BACKOFF;
+    uint8_t     pos;
+
+    GD_CHECK(queue.pushQueue(1, KIND_DONE, 0, false, now));
+    GD_CHECK_EQ(queue.getQueueCount(), 1);
+    GD_CHECK_EQ(queue.getQueueWait(now), GPSDOG_QUEUE_BACKOFF);
+    GD_CHECK_EQ(queue.getQueueNext(now), GPSDOG_QUEUE_NONE);
+
+    for (uint8_t i = 1; i < GPSDOG_QUEUE_RETRY; i++) {
+        // due over the millis() rollover
+        now += wait;
+        pos = queue.getQueueNext(now);
+
+        GD_CHECK_EQ(pos, 0);
+        GD_CHECK_EQ(queue.getQueueWait(now), 0);
+
+        queue.failQueue(pos, now);
+        wait *= 2;
+
+        GD_CHECK_EQ(queue.getQueueCount(), 1);
+        GD_CHECK_EQ(queue.getQueueWait(now), wait);
+        GD_CHECK_EQ(queue.getQueueNext(now + wait -1), GPSDOG_QUEUE_NONE);
+    }
+
+    // last try
+    now += wait;
+    queue.failQueue(queue.getQueueNext(now), now);
+    GD_CHECK_EQ(queue.getQueueCount(), 0);
+    GD_CHECK_EQ(queue.getQueueNext(now), GPSDOG_QUEUE_NONE);
+}
+
+/**
+ * The same message is only once in queue, a send entry is removed.
+ */
+static void testDone()
+{
+    GDQueue queue;
+
+    GD_CHECK(queue.pushQueue(1, KIND_DONE, 0, false, 0));
+    GD_CHECK(queue.pushQueue(1, KIND_DONE, 0, false, 0));
+    GD_CHECK(queue.pushQueue(2, KIND_DONE, 0, false, 0));
+    GD_CHECK(queue.pushQueue(1, KIND_STATUS, 0, false, 0));
+    GD_CHECK_EQ(queue.getQueueCount(), 3);
+
+    // remove in the middle
+    queue.doneQueue(1);
+    GD_CHECK_EQ(queue.getQueueCount(), 2);
+    GD_CHECK_EQ(queue.getQueueEntry(0)->m_numberIdx, 1);
+    GD_CHECK_EQ(queue.getQueueEntry(1)->m_kind, KIND_STATUS);
+}
+
+/**
+ * Alarms are send first and replace command replies in a full queue.
+ */
+static void testPriority()
+{
+    GDQueue queue;
+    uint8_t pos;
+
+    for (uint8_t i = 0; i < GPSDOG_QUEUE_SIZE; i++) {
+        GD_CHECK(queue.pushQueue(i, KIND_DONE, 0, false, 0));
+    }
+
+    // full
+    GD_CHECK(!queue.pushQueue(9, KIND_DONE, 0, false, 0));
+    GD_CHECK_EQ(queue.getQueueCount(), GPSDOG_QUEUE_SIZE);
+
+    // alarm replace the oldest reply
+    GD_CHECK(queue.pushQueue(9, KIND_STATUS, 0, true, 0));
+    GD_CHECK_EQ(queue.getQueueCount(), GPSDOG_QUEUE_SIZE);
+    GD_CHECK_EQ(queue.getQueueEntry(0)->m_numberIdx, 1);
+
+    // alarm first
+    pos = queue.getQueueNext(GPSDOG_QUEUE_BACKOFF);
+    GD_CHECK_EQ(queue.getQueueEntry(pos)->m_numberIdx, 9);
+    GD_CHECK(queue.getQueueEntry(pos)->m_alarm);
+
+    queue.doneQueue(pos);
+    pos = queue.getQueueNext(GPSDOG_QUEUE_BACKOFF);
+    GD_CHECK_EQ(queue.getQueueEntry(pos)->m_numberIdx, 1);
+
+    // only alarms, no place
+    for (uint8_t i = 0; i < GPSDOG_QUEUE_SIZE; i++) {
+        GD_CHECK(queue.pushQueue(i, KIND_STATUS, 0, true, 0));
+    }
+
+    GD_CHECK(!queue.pushQueue(10, KIND_STATUS, 0, true, 0));
+}
+
+/**
+ * Network is down for 20 min with a alarm every 5 min to 3 numbers. All
+ * alarms need to be send after it is back, a new alarm start the retries
+ * of the entry new.
+ */
+static void testOutage()
+{
+    GDQueue     queue;
+    uint32_t    now     = 0;
+    uint32_t    send    = 0;
+    uint32_t    late    = 0;
+    uint32_t    lost    = 0;
+    uint32_t    gaveUp  = 0;
+    uint32_t    lastLate = 0;
+    bool        online;
+    uint8_t     pos;
+
+    for (now = 0; now < 3600000; now += 1000) {
+        online = now >= 1200000;
+
+        // alarm to 3 numbers, the direct send fails
+        if (now % 300000 == 0) {
+            for (uint8_t i = 0; i < 3; i++) {
+                if (online) {
+                    send++;
+                }
+                else if (!queue.pushQueue(i, KIND_STATUS, 0, true, now)) {
+                    lost++;
+                }
+            }
+        }
+
+        while ((pos = queue.getQueueNext(now)) != GPSDOG_QUEUE_NONE) {
+            if (!online) {
+                if (!queue.failQueue(pos, now)) {
+                    gaveUp++;
+                }
+                break;
+            }
+
+            queue.doneQueue(pos);
+            send++;
+            late++;
+            lastLate = now;
+        }
+    }
+
+    printf("20 min outage: %u alarms send, %u from queue (last %u s after the network is back), %u lost, %u given up\n",
+        send, late, (lastLate - 1200000) / 1000, lost, gaveUp);
+
+    // one queue entry per number with the last alarm, it is not given up
+    GD_CHECK_EQ(lost, 0);
+    GD_CHECK_EQ(gaveUp, 0);
+    GD_CHECK_EQ(late, 3);
+    GD_CHECK_EQ(queue.getQueueCount(), 0);
+    GD_CHECK(lastLate - 1200000 <= GPSDOG_QUEUE_BACKOFF << (GPSDOG_QUEUE_RETRY -1));
+    GD_CHECK_EQ(send, 3 * 8 + 3);
+}
+
+int main()
+{
+    testBackoff();
+    testDone();
+    testPriority();
+    testOutage();
+
+    return gdTestResult("test_queue");
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
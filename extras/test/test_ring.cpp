@@ -0,0 +1,101 @@
+
+// Command latency (without modem time) and modem load: ring indicator
+// against SMS polling every second
+
+#include "dog.h"
+
+// commands in the hour
+#define COMMANDS 10
+
+/** Random value (xorshift32) */
+static uint32_t s_seed = 1;
+
+static uint32_t getRandom()
+{
+    s_seed ^= s_seed << 13;
+    s_seed ^= s_seed >> 17;
+    s_seed ^= s_seed << 5;
+
+    return s_seed;
+}
+
+/**
+ * One idle hour with some commands at random times.
+ *
+ * @param ring              Use the ring indicator, else poll every second
+ * @param latMax            Max millis from SMS to reply
+ * @param atCount           AT commands in the hour
+ */
+static void simulate(bool ring, uint32_t *latMax, uint32_t *atCount)
+{
+    GPSDog      dog;
+    uint32_t    start;
+    uint32_t    latency;
+    uint32_t    latSum  = 0;
+    uint32_t    checks;
+
+    EEPROM.erase();
+    dogStart(&dog, 0);
+
+    if (ring) {
+        dog.enableSMSSignal();
+    }
+
+    dogCommand("INIT pw1234 " DOG_OWNER " 0 OFF", ring);
+
+    s_seed          = 1;
+    s_atCount       = 0;
+    s_checkCount    = 0;
+    s_gpsCount      = 0;
+    *latMax         = 0;
+    start           = g_millis;
+
+    for (uint8_t i = 0; i < COMMANDS; i++) {
+        dogRun(start + i * (3600000UL / COMMANDS) + getRandom() % (3600000UL / COMMANDS / 2), ring);
+
+        latency = dogCommand("VERSION", ring);
+        latSum  += latency;
+
+        if (latency > *latMax) {
+            *latMax = latency;
+        }
+    }
+
+    dogRun(start + 3600000UL, ring);
+
+    checks      = s_checkCount;
+    *atCount    = s_atCount;
+
+    printf("%s: latency mean %4u ms, max %4u ms / per hour %4u SMS checks, %4u AT commands (%u GPS)\n", ring ? "ring indicator" : "poll 1 sec     ",
+        latSum / COMMANDS, *latMax, checks, *atCount, s_gpsCount);
+
+    GD_CHECK_EQ(dog.getDroppedSMS(), 0);
+}
+
+/**
+ * The ring indicator answer faster and the modem is not asked every
+ * second.
+ */
+static void testRing()
+{
+    uint32_t pollMax;
+    uint32_t pollAT;
+    uint32_t ringMax;
+    uint32_t ringAT;
+
+    simulate(false, &pollMax, &pollAT);
+    simulate(true, &ringMax, &ringAT);
+
+    GD_CHECK(pollMax <= GPSDOG_WAIT_SMS);
+    GD_CHECK(ringMax < 100);
+    GD_CHECK(ringAT * 5 < pollAT);
+}
+
+int main()
+{
+    testRing();
+
+    return gdTestResult("test_ring");
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
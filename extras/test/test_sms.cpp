@@ -0,0 +1,249 @@
+
+// GDSms tokenizer and a benchmark against the old rescan per element
+
+#include <time.h>
+
+#include "test.h"
+#include "GDSms.h"
+
+/**
+ * GDSms with a own message buffer.
+ */
+class TestSms : public GDSms
+{
+    public:
+
+        char    m_buffer[161];
+
+        TestSms() {
+            m_message       = m_buffer;
+            m_messageSize   = sizeof(m_buffer) -1;
+        }
+
+        uint8_t parse(const char *txt) {
+            memset(m_buffer, 0x00, sizeof(m_buffer));
+            strncpy(m_buffer, txt, sizeof(m_buffer) -1);
+
+            return this->parseSMSMessage();
+        }
+
+        bool isElement(uint8_t idx, const char *txt) {
+            char *element = this->getParseElement(idx);
+
+            return element != NULL && this->getParseElementSize(idx) == strlen(txt) && strncmp(element, txt, strlen(txt)) == 0;
+        }
+};
+
+/** Count of char they the old parser read */
+static uint32_t s_oldReads = 0;
+
+/** Runs of a command for the host time */
+#define BENCH_RUNS 200000
+
+/** Result of the runs, the compiler can't remove them */
+static volatile uintptr_t s_sink = 0;
+
+/**
+ * Old parser: replace spaces with '\0' and search every element from the
+ * start of message.
+ */
+static uint8_t oldParse(char *msg, uint8_t size)
+{
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < size; i++) {
+        s_oldReads++;
+
+        if (msg[i] == 0x00) {
+            return count;
+        }
+        else if (msg[i] == 0x20) {
+            msg[i] = 0x00;
+        }
+
+        if (i > 0 && msg[i] == 0x00 && msg[i -1] != 0x00) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+static char* oldElement(char *msg, uint8_t size, uint8_t idx)
+{
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < size; i++) {
+        s_oldReads++;
+
+        if (msg[i] == 0x00 && i > 0 && msg[i -1] != 0x00) {
+            count++;
+        }
+
+        if (count == idx && msg[i] != 0x00) {
+            return &msg[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void testTokens()
+{
+    TestSms sms;
+
+    GD_CHECK_EQ(sms.parse("STORE 2 ADD +41791234567 3 ON"), 5);
+    GD_CHECK(sms.isElement(0, "STORE"));
+    GD_CHECK(sms.isElement(3, "+41791234567"));
+    GD_CHECK(sms.isElement(5, "ON"));
+    GD_CHECK(sms.getParseElement(6) == NULL);
+    GD_CHECK_EQ(sms.getParseElementSize(6), 0);
+
+    // message is not changed, it can be forward
+    GD_CHECK(strcmp(sms.m_buffer, "STORE 2 ADD +41791234567 3 ON") == 0);
+
+    // leading, repeated and other whitespace
+    GD_CHECK_EQ(sms.parse("  \tWATCH   on \r\n"), 1);
+    GD_CHECK(sms.isElement(0, "WATCH"));
+    GD_CHECK(sms.isElement(1, "on"));
+    GD_CHECK(sms.cmpParseElement(1, PSTR("ON")));
+    GD_CHECK(!sms.cmpParseElement(1, PSTR("OFF")));
+    GD_CHECK(!sms.cmpParseElement(0, PSTR("WATC")));
+
+    // empty
+    GD_CHECK_EQ(sms.parse("   "), 0);
+    GD_CHECK(sms.getParseElement(0) == NULL);
+    GD_CHECK_EQ(sms.parse(""), 0);
+
+    // more elements as the table, count is right
+    GD_CHECK_EQ(sms.parse("ZONE 1 POLY 1,1 2,2 3,3 4,4 5,5 6,6 7,7 8,8"), 10);
+    GD_CHECK(sms.isElement(GPSDOG_SMS_MAX_TOKEN -1, "7,7"));
+    GD_CHECK(sms.getParseElement(GPSDOG_SMS_MAX_TOKEN) == NULL);
+}
+
+static void testCopy()
+{
+    TestSms sms;
+    char    buffer[5];
+
+    sms.parse("INIT pw1234 +41791234567");
+
+    GD_CHECK(sms.copyParseElement(0, buffer, sizeof(buffer)));
+    GD_CHECK(strcmp(buffer, "INIT") == 0);
+
+    // to long for buffer with '\0'
+    GD_CHECK(!sms.copyParseElement(1, buffer, sizeof(buffer)));
+    GD_CHECK(!sms.copyParseElement(3, buffer, sizeof(buffer)));
+}
+
+static void testPeek()
+{
+    TestSms sms;
+
+    // before the parser, like processIncomingSMS
+    strcpy(sms.m_buffer, " init pw 0791 1 ON");
+    GD_CHECK(sms.peekSMSCommand(PSTR("INIT")));
+    GD_CHECK(!sms.peekSMSCommand(PSTR("RESET")));
+
+    strcpy(sms.m_buffer, "INITX pw");
+    GD_CHECK(!sms.peekSMSCommand(PSTR("INIT")));
+
+    strcpy(sms.m_buffer, "RESET");
+    GD_CHECK(sms.peekSMSCommand(PSTR("RESET")));
+}
+
+/**
+ * Nanoseconds since a start value.
+ */
+static double getNanos(clock_t start)
+{
+    return static_cast<double>(clock() - start) * 1000000000.0 / CLOCKS_PER_SEC;
+}
+
+/**
+ * Parse a command and read every element twice like the handlers. The
+ * old parser scan the message for every element, the new one only once
+ * and the elements are a table lookup.
+ *
+ * The char reads are a proxy for the AVR cycles, the old parser is counted
+ * and the new one read every char once (message length). The host time is
+ * measured, but it is not the time on the AVR.
+ */
+static void benchCommand(const char *txt)
+{
+    TestSms     sms;
+    char        msg[161];
+    uint8_t     count;
+    uint32_t    oldReads;
+    bool        same = true;
+    uintptr_t   sum  = 0;
+    clock_t     start;
+    double      oldTime;
+    double      newTime;
+
+    memset(msg, 0x00, sizeof(msg));
+    strcpy(msg, txt);
+
+    s_oldReads  = 0;
+    count       = oldParse(msg, 160) +1;
+
+    GD_CHECK_EQ(sms.parse(txt) +1, count);
+
+    for (uint8_t i = 0; i < count * 2; i++) {
+        same = same && oldElement(msg, 160, i % count) - msg == sms.getParseElement(i % count) - sms.m_buffer;
+    }
+
+    GD_CHECK(same);
+    oldReads = s_oldReads;
+
+    ////
+    // host time, the message is copied like a new SMS for both
+    start = clock();
+
+    for (uint32_t run = 0; run < BENCH_RUNS; run++) {
+        memset(msg, 0x00, sizeof(msg));
+        strcpy(msg, txt);
+        oldParse(msg, 160);
+
+        for (uint8_t i = 0; i < count * 2; i++) {
+            sum += reinterpret_cast<uintptr_t>(oldElement(msg, 160, i % count));
+        }
+    }
+
+    oldTime = getNanos(start) / BENCH_RUNS;
+    start   = clock();
+
+    for (uint32_t run = 0; run < BENCH_RUNS; run++) {
+        sms.parse(txt);
+
+        for (uint8_t i = 0; i < count * 2; i++) {
+            sum += reinterpret_cast<uintptr_t>(sms.getParseElement(i % count));
+        }
+    }
+
+    newTime = getNanos(start) / BENCH_RUNS;
+    s_sink  = sum;
+
+    printf("%2u elements, %2u chars: char reads old %3u, new %2u (proxy), host time old %4.0f ns, new %4.0f ns\n", count,
+        static_cast<unsigned>(strlen(txt)), oldReads, static_cast<unsigned>(strlen(txt)), oldTime, newTime);
+}
+
+static void testBenchmark()
+{
+    benchCommand("WATCH ON");
+    benchCommand("STORE 12 ADD +41791234567 3 ON");
+    benchCommand("ZONE 1 POLY 47.1,8.1 47.2,8.2 47.3,8.1 47.2,8.0");
+    benchCommand("ZONE 2 POLY 47.10,8.10 47.20,8.20 47.30,8.10 47.25,8.05 47.20,8.00 47.15,8.02");
+}
+
+int main()
+{
+    testTokens();
+    testCopy();
+    testPeek();
+    testBenchmark();
+
+    return gdTestResult("test_sms");
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
@@ -0,0 +1,178 @@
+
+// GDTimer over a millis() rollover
+
+#include "test.h"
+#include "GDTimer.h"
+
+// one day in millis
+#define DAY 86400000ULL
+
+/**
+ * Deadline compare around the rollover.
+ */
+static void testReached()
+{
+    GD_CHECK(GDTimer::isReached(0x00000100, 0x00000100));
+    GD_CHECK(!GDTimer::isReached(0x00000100, 0xFFFFFFF0));
+    GD_CHECK(GDTimer::isReached(0xFFFFFFF0, 0x00000100));
+    GD_CHECK(!GDTimer::isReached(0x00000101, 0x00000100));
+}
+
+/**
+ * A one-shot timer they expire after the rollover.
+ */
+static void testOneShot()
+{
+    GDTimer     timer;
+    uint32_t    now = 0xFFFFFF00;
+
+    timer.startTimer(0, now, 0x200, 0);
+
+    GD_CHECK_EQ(timer.getTimeLeft(0, now), 0x200);
+    GD_CHECK(!timer.isTimerDue(0, 0xFFFFFFFF));
+    GD_CHECK_EQ(timer.getTimeLeft(0, 0x00000000), 0x100);
+    GD_CHECK(!timer.isTimerDue(0, 0x000000FF));
+    GD_CHECK(timer.isTimerDue(0, 0x00000100));
+
+    // only once
+    GD_CHECK(!timer.isTimerActive(0));
+    GD_CHECK(!timer.isTimerDue(0, 0x00000200));
+    GD_CHECK_EQ(timer.getTimeLeft(0, 0x00000200), 0);
+}
+
+/**
+ * The earliest deadline is found also if it has the bigger value.
+ */
+static void testNextDeadline()
+{
+    GDTimer     timer;
+    uint32_t    now = 0xFFFFF000;
+
+    // 0x00000F00 (after rollover) and 0xFFFFF800
+    timer.startTimer(0, now, 0x1F00, 0);
+    timer.startTimer(1, now, 0x0800, 0);
+
+    GD_CHECK_EQ(timer.getNextDeadline(now, 30000), 0xFFFFF800);
+
+    timer.stopTimer(1);
+    GD_CHECK_EQ(timer.getNextDeadline(now, 30000), 0x00000F00);
+
+    // nothing running
+    timer.stopTimer(0);
+    GD_CHECK_EQ(timer.getNextDeadline(now, 30000), static_cast<uint32_t>(now + 30000));
+}
+
+/**
+ * A late tick catch up only once and restart from now.
+ */
+static void testCatchUp()
+{
+    GDTimer     timer;
+    uint32_t    now = 0xFFFF0000;
+
+    timer.startTimer(0, now, 30000, 30000);
+
+    // 3.5 periods late, over the rollover
+    now += 105000;
+    GD_CHECK(timer.isTimerDue(0, now));
+    GD_CHECK(!timer.isTimerDue(0, now));
+    GD_CHECK_EQ(timer.getTimeLeft(0, now), 30000);
+}
+
+/**
+ * 50 days uptime like GPSDog: periodic poll, a alarm they restart on
+ * expire and ticks with jitter. The virtual 64 bit clock is the
+ * reference, millis() is the low 32 bit.
+ */
+static void testUptime()
+{
+    GDTimer     timer;
+    uint64_t    clock       = 0;
+    uint64_t    pollNext    = 30000;
+    uint64_t    alarmNext   = 900000;
+    uint64_t    lastPoll    = 0;
+    uint32_t    polls       = 0;
+    uint32_t    alarms      = 0;
+    uint32_t    maxLate     = 0;
+    uint32_t    maxGap      = 0;
+    uint32_t    seed        = 1;
+    uint32_t    step;
+    bool        wrapped     = false;
+
+    timer.startTimer(0, 0, 30000, 30000);
+    timer.startTimer(1, 0, 900000, 0);
+
+    while (clock < 50 * DAY) {
+        // tick after 0.5 - 2.5 sec
+        seed    = seed * 1103515245 + 12345;
+        step    = 500 + (seed >> 16) % 2000;
+        clock   += step;
+
+        if (clock > 0xFFFFFFFFULL) {
+            wrapped = true;
+        }
+
+        ////
+        // Poll
+        if (timer.isTimerDue(0, static_cast<uint32_t>(clock))) {
+            GD_CHECK(clock >= pollNext);
+
+            if (clock - pollNext > maxLate) {
+                maxLate = clock - pollNext;
+            }
+            if (lastPoll > 0 && clock - lastPoll > maxGap) {
+                maxGap = clock - lastPoll;
+            }
+
+            lastPoll    = clock;
+            pollNext    += 30000;
+
+            // lost periods restart from now
+            if (pollNext <= clock) {
+                pollNext = clock + 30000;
+            }
+
+            polls++;
+        }
+        else {
+            GD_CHECK(clock < pollNext);
+        }
+
+        ////
+        // Alarm resend
+        if (timer.isTimerDue(1, static_cast<uint32_t>(clock))) {
+            GD_CHECK(clock >= alarmNext && clock - alarmNext < 2500);
+
+            alarmNext = clock + 900000;
+            timer.startTimer(1, static_cast<uint32_t>(clock), 900000, 0);
+            alarms++;
+        }
+        else {
+            GD_CHECK(clock < alarmNext);
+        }
+
+        // next wake up is never after a deadline
+        GD_CHECK(timer.getNextDeadline(static_cast<uint32_t>(clock), 30000) == static_cast<uint32_t>(pollNext < alarmNext ? pollNext : alarmNext));
+    }
+
+    GD_CHECK(wrapped);
+    GD_CHECK(maxLate < 2500);
+    GD_CHECK(maxGap < 30000 + 2500);
+    GD_CHECK_EQ(polls, 50 * DAY / 30000);
+    GD_CHECK(alarms >= 50 * DAY / 902500 && alarms <= 50 * DAY / 900000);
+
+    printf("50 days: %u polls, %u alarms, max late %u ms\n", polls, alarms, maxLate);
+}
+
+int main()
+{
+    testReached();
+    testOneShot();
+    testNextDeadline();
+    testCatchUp();
+    testUptime();
+
+    return gdTestResult("test_timer");
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
@@ -0,0 +1,387 @@
+
+// GDTrack delta/varint ring buffer, simplification, EEPROM spill and write
+// rate of a alarm
+
+#include <math.h>
+
+#include "test.h"
+#include "GPSDog.h"
+
+// meters per microdegree latitude
+#define METER 0.111195
+
+/** Random value (xorshift32) */
+static uint32_t s_seed = 1;
+
+static uint32_t getRandom()
+{
+    s_seed ^= s_seed << 13;
+    s_seed ^= s_seed >> 17;
+    s_seed ^= s_seed << 5;
+
+    return s_seed;
+}
+
+/**
+ * Microdegrees to track units like @see GDTrack::addTrack.
+ */
+static int32_t toUnit(int32_t val)
+{
+    return (val < 0 ? val - GPSDOG_TRACK_QUANT / 2 : val + GPSDOG_TRACK_QUANT / 2) / GPSDOG_TRACK_QUANT;
+}
+
+/**
+ * Compare points, time is compared with a offset.
+ */
+static bool isSamePoint(GD_TRACK_POINT *point, int32_t lat, int32_t lon, uint32_t time)
+{
+    return point->m_latitude == lat && point->m_longitude == lon && point->m_time == time;
+}
+
+/**
+ * Zigzag with 90° corners, every point is stored. Long legs, negative
+ * positions and big time steps need varints with many bytes. The oldest
+ * points are dropped, the rest need to be the same.
+ */
+static void testRoundTrip()
+{
+    GDTrack         track;
+    GD_TRACK_POINT  points[0xFF];
+    int32_t         lat[200];
+    int32_t         lon[200];
+    uint32_t        time[200];
+    int32_t         pLat    = -33868800;
+    int32_t         pLon    = -151209300;
+    uint32_t        pTime   = 1000;
+    uint8_t         count;
+    uint8_t         fails   = 0;
+
+    track.cleanTrack();
+
+    for (uint8_t i = 0; i < 200; i++) {
+        int32_t dist = 50 + getRandom() % 5000;
+
+        if (i % 2 == 0) {
+            pLat += (i % 4 == 0 ? dist : -dist) / METER;
+        }
+        else {
+            pLon += dist / METER;
+        }
+
+        pTime   += 1 + getRandom() % 100000;
+        lat[i]  = toUnit(pLat);
+        lon[i]  = toUnit(pLon);
+        time[i] = pTime;
+
+        track.addTrack(pLat, pLon, pTime);
+    }
+
+    count = track.getTrack(points, 0xFF);
+
+    GD_CHECK(count > 10 && count < 200);
+    GD_CHECK_EQ(count, track.getTrackCount());
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (!isSamePoint(&points[i], lat[200 - count + i], lon[200 - count + i], time[200 - count + i])) {
+            fails++;
+        }
+    }
+
+    GD_CHECK_EQ(fails, 0);
+
+    // only the newest
+    GD_CHECK_EQ(track.getTrack(points, 3), 3);
+    GD_CHECK(isSamePoint(&points[2], lat[199], lon[199], time[199]));
+    GD_CHECK(isSamePoint(&points[0], lat[197], lon[197], time[197]));
+}
+
+/**
+ * Distance of a point to a segment in meters, all in track units.
+ */
+static double getDistance(GD_TRACK_POINT *a, GD_TRACK_POINT *b, double lat, double lon)
+{
+    double  scale   = cos(a->m_latitude * GPSDOG_TRACK_QUANT / 1000000.0 * M_PI / 180.0);
+    double  ex      = (b->m_longitude - a->m_longitude) * scale;
+    double  ey      = b->m_latitude - a->m_latitude;
+    double  px      = (lon - a->m_longitude) * scale;
+    double  py      = lat - a->m_latitude;
+    double  len     = ex * ex + ey * ey;
+    double  t       = len > 0 ? (px * ex + py * ey) / len : 0;
+
+    if (t < 0) {
+        t = 0;
+    }
+    else if (t > 1) {
+        t = 1;
+    }
+
+    return hypot(px - t * ex, py - t * ey) * GPSDOG_TRACK_QUANT * METER;
+}
+
+/**
+ * Replay a trace with a fix every 10 sec and noise of +/- 3 m. Every
+ * fix is compared with the segment of the simplified track at the same
+ * time. Raw is the count of points without simplification (only the
+ * GPSDOG_TRACK_MOVE skip).
+ *
+ * @param name              Name of trace
+ * @param urban             TRUE for a street grid with corners, else a highway
+ */
+static void benchSimplify(const char *name, bool urban)
+{
+    GDTrack         track;
+    GD_TRACK_POINT  points[0xFF];
+    int32_t         lat[60];
+    int32_t         lon[60];
+    int32_t         rawLat  = 0;
+    int32_t         rawLon  = 0;
+    int32_t         pLat    = 47000000;
+    int32_t         pLon    = 8000000;
+    double          angle   = 0;
+    double          dist;
+    double          maxDist = 0;
+    double          sumDist = 0;
+    uint8_t         count;
+    uint8_t         raw     = 0;
+    uint8_t         seg     = 0;
+    uint8_t         tests   = 0;
+
+    track.cleanTrack();
+
+    for (uint8_t i = 0; i < 60; i++) {
+        ////
+        // Urban: 10 m/s, turn on some crossings / Highway: 30 m/s, curves
+        if (urban) {
+            if (i % 6 == 0 && getRandom() % 2 == 0) {
+                angle += getRandom() % 2 == 0 ? M_PI / 2 : -M_PI / 2;
+            }
+
+            dist = 100;
+        }
+        else {
+            angle   += (static_cast<int32_t>(getRandom() % 5) - 2) * M_PI / 180.0;
+            dist    = 300;
+        }
+
+        pLat    += lround(dist * cos(angle) / METER);
+        pLon    += lround(dist * sin(angle) / (METER * cos(pLat / 1000000.0 * M_PI / 180.0)));
+        lat[i]  = pLat + lround((static_cast<int32_t>(getRandom() % 7) - 3) / METER);
+        lon[i]  = pLon + lround((static_cast<int32_t>(getRandom() % 7) - 3) / METER);
+
+        track.addTrack(lat[i], lon[i], i * 10);
+
+        // without simplification
+        if (i == 0 || GDGps::toMeters(lat[i] - rawLat) >= GPSDOG_TRACK_MOVE || GDGps::toMeters(lon[i] - rawLon) >= GPSDOG_TRACK_MOVE) {
+            rawLat = lat[i];
+            rawLon = lon[i];
+            raw++;
+        }
+    }
+
+    count = track.getTrack(points, 0xFF);
+
+    ////
+    // Error of every fix they is in the track
+    for (uint8_t i = 0; i < 60; i++) {
+        if (i * 10 < points[0].m_time) {
+            continue;
+        }
+
+        while (seg < count -2 && points[seg +1].m_time <= i * 10) {
+            seg++;
+        }
+
+        dist = getDistance(&points[seg], &points[seg +1], lat[i] / static_cast<double>(GPSDOG_TRACK_QUANT), lon[i] / static_cast<double>(GPSDOG_TRACK_QUANT));
+
+        if (dist > maxDist) {
+            maxDist = dist;
+        }
+
+        sumDist += dist;
+        tests++;
+    }
+
+    printf("%s: %u fixes, %u points (raw %u), error max %.1f m, mean %.1f m (tolerance %u m)\n", name, tests, count, raw, maxDist, sumDist / tests, GPSDOG_TRACK_TOLERANCE);
+
+    // all fixes are in the track
+    GD_CHECK_EQ(tests, 60);
+    GD_CHECK(count < raw / 2);
+
+    // tolerance + noise and track units
+    GD_CHECK(maxDist < GPSDOG_TRACK_TOLERANCE + 5);
+}
+
+static void testSimplify()
+{
+    benchSimplify("urban", true);
+    benchSimplify("highway", false);
+}
+
+/**
+ * Drive 1 h on a curved road with a fix every 10 sec and spill it to
+ * EEPROM. Count the stored points and bytes per point against 12 bytes
+ * of a raw point.
+ */
+static void testCompress()
+{
+    GDTrack     track;
+    int32_t     lat     = 47000000;
+    int32_t     lon     = 8000000;
+    double      angle   = 0;
+    uint8_t     count;
+    uint8_t     size;
+
+    EEPROM.erase();
+    track.cleanTrack();
+
+    for (uint16_t i = 0; i < 360; i++) {
+        angle   += (static_cast<int32_t>(getRandom() % 11) - 5) * M_PI / 180.0;
+        lat     += lround(250 * cos(angle) / METER);
+        lon     += lround(250 * sin(angle) / (METER * cos(lat / 1000000.0 * M_PI / 180.0)));
+
+        track.addTrack(lat, lon, i * 10);
+    }
+
+    track.saveTrack();
+
+    count   = EEPROM.read(GPSDOG_TRACK_START + 13);
+    size    = EEPROM.read(GPSDOG_TRACK_START + 14);
+
+    printf("1 h drive: 360 fixes, %u points in EEPROM, %.1f bytes per point (raw %u)\n", count, static_cast<double>(size) / count, static_cast<unsigned>(sizeof(GD_TRACK_POINT)));
+
+    GD_CHECK(count > 10);
+    GD_CHECK(size <= GPSDOG_TRACK_SPILL);
+    GD_CHECK(size < count * sizeof(GD_TRACK_POINT) / 2);
+}
+
+/**
+ * Save and load, the newest point get the time now. A broken byte or a
+ * clean track is not loaded.
+ */
+static void testSaveLoad()
+{
+    GDTrack         track;
+    GDTrack         check;
+    GD_TRACK_POINT  points[GPSDOG_TRACK_SMS_MAX];
+    GD_TRACK_POINT  loaded[GPSDOG_TRACK_SMS_MAX];
+    uint8_t         count;
+    uint32_t        writes;
+
+    EEPROM.erase();
+    track.cleanTrack();
+    GD_CHECK(!track.isTrackChanged());
+
+    for (uint8_t i = 0; i < 40; i++) {
+        track.addTrack(47000000 + (i % 2) * 9000, 8000000 + i * 5000, 100 + i * 10);
+    }
+
+    GD_CHECK(track.isTrackChanged());
+    track.saveTrack();
+    GD_CHECK(!track.isTrackChanged());
+
+    count = track.getTrack(points, GPSDOG_TRACK_SMS_MAX);
+
+    GD_CHECK(check.loadTrack(5000));
+    GD_CHECK(!check.isTrackChanged());
+    GD_CHECK_EQ(check.getTrack(loaded, GPSDOG_TRACK_SMS_MAX), count);
+
+    for (uint8_t i = 0; i < count; i++) {
+        GD_CHECK(isSamePoint(&loaded[i], points[i].m_latitude, points[i].m_longitude, points[i].m_time - points[count -1].m_time + 5000));
+    }
+
+    ////
+    // Same track is not written again
+    writes = 0;
+
+    for (uint16_t i = GPSDOG_TRACK_START; i <= E2END; i++) {
+        writes += EEPROM.m_writes[i];
+    }
+
+    // near the newest point
+    track.addTrack(47000000 + 9000 * (39 % 2), 8000000 + 39 * 5000 + 10, 600);
+    track.saveTrack();
+
+    for (uint16_t i = GPSDOG_TRACK_START; i <= E2END; i++) {
+        writes -= EEPROM.m_writes[i];
+    }
+
+    GD_CHECK_EQ(writes, 0);
+
+    ////
+    // Broken
+    EEPROM.write(GPSDOG_TRACK_START + GPSDOG_TRACK_HEADER + 1, EEPROM.read(GPSDOG_TRACK_START + GPSDOG_TRACK_HEADER + 1) ^ 0x01);
+    GD_CHECK(!check.loadTrack(5000));
+    GD_CHECK_EQ(check.getTrackCount(), 0);
+
+    // clean
+    track.cleanTrack();
+    GD_CHECK(!check.loadTrack(5000));
+}
+
+/**
+ * 24 h in ALARM: the car is driven 30 min and then parked. A alarm SMS
+ * is send every 3 min with a snapshot. The old code saved the track on
+ * every snapshot of a alarm, so the magic cell was written twice on
+ * every save. Now it is only saved if it is changed and not more as
+ * every GPSDOG_WAIT_TRACK_MIN like @see GPSDog::saveSnapshot.
+ */
+static void testAlarmWear()
+{
+    GDTrack     track;
+    int32_t     lat         = 47000000;
+    int32_t     lon         = 8000000;
+    uint32_t    trackTime   = 0;
+    uint32_t    saves       = 0;
+    uint32_t    oldMax      = 0;
+    uint32_t    newMax;
+
+    EEPROM.erase();
+    track.cleanTrack();
+
+    for (uint32_t now = 10000; now <= 86400000UL; now += 10000) {
+        // drive / parked with noise
+        if (now <= 1800000UL) {
+            lat += lround(139 / METER);
+        }
+
+        track.addTrack(lat + static_cast<int32_t>(getRandom() % 91) - 45, lon + static_cast<int32_t>(getRandom() % 91) - 45, now / 1000);
+
+        // alarm SMS with snapshot
+        if (now % 180000 != 0) {
+            continue;
+        }
+
+        oldMax += 2;
+
+        if (track.isTrackChanged() && (trackTime == 0 || GDTimer::isReached(trackTime + GPSDOG_WAIT_TRACK_MIN, now))) {
+            track.saveTrack();
+            trackTime = now;
+            saves++;
+        }
+    }
+
+    newMax = EEPROM.maxWrites(GPSDOG_TRACK_START, E2END + 1);
+
+    printf("24 h alarm: %u track saves, hottest cell %u writes (old %u)\n", saves, newMax, oldMax);
+
+    GD_CHECK(newMax <= 2 * (86400000UL / GPSDOG_WAIT_TRACK_MIN + 1));
+    GD_CHECK(newMax < oldMax / 10);
+
+    // the way is kept
+    GDTrack check;
+    GD_CHECK(check.loadTrack(0));
+    GD_CHECK(check.getTrackCount() > 2);
+}
+
+int main()
+{
+    testRoundTrip();
+    testSimplify();
+    testCompress();
+    testSaveLoad();
+    testAlarmWear();
+
+    return gdTestResult("test_track");
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
@@ -3,17 +3,80 @@
 #include "GPSDog.h"
 
 
+// sorted by name, @see s_commandIdx
+const GD_COMMAND GPSDog::s_commands[] PROGMEM = {
+    // ALARM ON/OFF/?
+    {"ALARM",   5, 1, 1, GPSDOG_AUTH_LEGAL,     GPSDOG_MODE_ALARM,      &GPSDog::readModeFromSMS},
+    // FORWARD ON/OFF/?
+    {"FORWARD", 7, 1, 1, GPSDOG_AUTH_LEGAL,     GPSDOG_MODE_FORWARD,    &GPSDog::readModeFromSMS},
+    // INIT pw number sign ON/OFF
+    {"INIT",    4, 4, 4, GPSDOG_AUTH_NONE,      0x00,                   &GPSDog::readInitFromSMS},
+    // POWER
+    {"POWER",   5, 0, 0, GPSDOG_AUTH_LEGAL,     GPSDOG_OPT_SMS_POWER,   &GPSDog::readInfoFromSMS},
+    // PROTECT ON/OFF/?
+    {"PROTECT", 7, 1, 1, GPSDOG_AUTH_LEGAL,     GPSDOG_MODE_PROTECT,    &GPSDog::readModeFromSMS},
+    // RESET pw
+    {"RESET",   5, 1, 1, GPSDOG_AUTH_NONE,      0x00,                   &GPSDog::readResetFromSMS},
+    // SET INTERVAL min
+    // SET FORWARD idx
+    // SET GEOFIX meters
+    // SET UNIT KMH/MPH
+    {"SET",     3, 2, 2, GPSDOG_AUTH_LEGAL,     0x00,                   &GPSDog::readSetFromSMS},
+    // STATUS
+    {"STATUS",  6, 0, 0, GPSDOG_AUTH_PROTECT,   GPSDOG_OPT_SMS_STATUS,  &GPSDog::readInfoFromSMS},
+    // STOP
+    {"STOP",    4, 0, 0, GPSDOG_AUTH_LEGAL,     0x00,                   &GPSDog::readStopFromSMS},
+    // STORE idx ADD number sign ON/OFF
+    // STORE idx DEL
+    // STORE idx SHOW
+    {"STORE",   5, 2, 5, GPSDOG_AUTH_LEGAL,     0x00,                   &GPSDog::readStoreFromSMS},
+    // TRACK [count]
+    {"TRACK",   5, 0, 1, GPSDOG_AUTH_LEGAL,     0x00,                   &GPSDog::readTrackFromSMS},
+    // VERSION
+    {"VERSION", 7, 0, 0, GPSDOG_AUTH_LEGAL,     GPSDOG_OPT_SMS_VERSION, &GPSDog::readInfoFromSMS},
+    // WATCH ON/OFF/?
+    {"WATCH",   5, 1, 1, GPSDOG_AUTH_LEGAL,     GPSDOG_MODE_WATCH,      &GPSDog::readModeFromSMS},
+    // ZONE idx CIRCLE lat,lon meters
+    // ZONE idx POLY lat,lon lat,lon lat,lon ...
+    // ZONE idx DEL
+    {"ZONE",    4, 2, 8, GPSDOG_AUTH_LEGAL,     0x00,                   &GPSDog::readZoneFromSMS}
+};
+
+// first entry in s_commands for A - Z and the end
+const uint8_t GPSDog::s_commandIdx[] PROGMEM = {
+//  A  B  C  D  E  F  G  H  I  J  K  L  M  N  O  P  Q  R  S  T   U   V   W   X   Y   Z   end
+    0, 1, 1, 1, 1, 1, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 5, 5, 6, 10, 11, 11, 12, 13, 13, 13, 14
+};
+
 GPSDog::GPSDog()
 {
     m_isInit            = false;
-    m_alarmOverload     = false;
     m_gpsFix            = false;
-
-    m_nextAlarmSMS      ^= m_nextAlarmSMS;
-    m_alarmStartTime    ^= m_alarmStartTime;
+    m_fixSamples        ^= m_fixSamples;
+    m_goodFix           = false;
+    m_snapCheck         = false;
+    m_snapTime          ^= m_snapTime;
+    m_trackTime         ^= m_trackTime;
+    m_gpsPeriod         = GPSDOG_WAIT_GPS_MIN;
+    m_newSMS            = false;
+    m_idleMode          = false;
+    m_droppedSMS        ^= m_droppedSMS;
+    m_smsKind           = GPSDOG_OPT_SMS_NONE;
+    m_smsPayload        ^= m_smsPayload;
+    m_broadcastCount    ^= m_broadcastCount;
+    m_watchCos          ^= m_watchCos;
+    cb_broadcastSMS     = NULL;
+
+    m_now               ^= m_now;
+
+    // timer after boot
+    this->startTimer(GPSDOG_TIMER_GPSFIX, 0, GPSDOG_WAIT_GPSFIX, 0);
+    this->startTimer(GPSDOG_TIMER_GPS, 0, 0, GPSDOG_WAIT_GPS_MIN);
+    this->startTimer(GPSDOG_TIMER_SMS, 0, 0, GPSDOG_WAIT_SMS);
+    this->startTimer(GPSDOG_TIMER_SNAP, 0, GPSDOG_WAIT_SNAP, GPSDOG_WAIT_SNAP);
 }
         
-void GPSDog::initialize(char *smsNum, uint8_t smsNumSize, char *smsTxt, uint8_t smsTxtSize, void (*cbSendSMS)(), void (*cbCheckSMS)(), void (*cbReloadSMS)(), void (*cbReceiveGPS)())
+void GPSDog::initialize(char *smsNum, uint8_t smsNumSize, char *smsTxt, uint8_t smsTxtSize, bool (*cbSendSMS)(), void (*cbCheckSMS)(), void (*cbReceiveGPS)())
 {
     // init data
     m_number            = smsNum;
@@ -25,15 +88,27 @@ void GPSDog::initialize(char *smsNum, uint8_t smsNumSize, char *smsTxt, uint8_t
     // callbacks
     cb_sendSMS          = cbSendSMS;
     cb_checkNewSMS      = cbCheckSMS;
-    cb_reloadSMS        = cbReloadSMS;
     cb_receiveGPS       = cbReceiveGPS;
 
+    // read config from EEPROM
+    this->loadConfig();
+    this->loadFence();
+
+    // state before reset / clock until the first tick
+    m_now = this->getTime();
+
+    this->restoreSnapshot();
+    this->loadTrack(m_now / 1000);
+
     // set init flag
     m_isInit            = true;
 }
 
 void GPSDog::mainProcessing()
 {
+    uint32_t next;
+    uint32_t now;
+
     // check is init
     if (!m_isInit) {
         return;
@@ -42,144 +117,164 @@ void GPSDog::mainProcessing()
     while (1) {
 
         ////
-        // if Alarm mode is on
-        if (this->isModeOn(GPSDOG_MODE_ALARM) && m_gpsFix) {
-            // Time to new send a alarm
-            if (m_nextAlarmSMS <= millis() && !m_alarmOverload) {
-                this->sendAlarmSMS();
+        // run all work they is due
+        next    = this->tick(this->getTime());
+        now     = this->getTime();
+
+        ////
+        // wait for next deadline or a new SMS
+        while (!m_newSMS && !GDTimer::isReached(next, now)) {
+            // sleep if it is possible
+            if (m_idleMode) {
+                this->sleepFor(next - now);
             }
+
+            now = this->getTime();
         }
+    }
+}
 
-        ////
-        // processing GPS data
-        if (!m_gpsFix && millis() >= GPSDOG_WAIT_GPSFIX) {
-            // wait time after boot is ok, position is fix
-            m_gpsFix = true; 
+void GPSDog::enableSMSSignal()
+{
+    this->startTimer(GPSDOG_TIMER_SMS, m_now, GPSDOG_WAIT_SMS_SIGNAL, GPSDOG_WAIT_SMS_SIGNAL);
+}
 
-            // if GPSDog wait for watching out
-            if (this->isModeOn(GPSDOG_MODE_DOWATCH)) {
-                this->doWatching();
+uint32_t GPSDog::tick(uint32_t now)
+{
+    m_now = now;
 
-                // Reset state & save
-                this->setMode(GPSDOG_MODE_DOWATCH, false);
-                this->writeConfig();
+    // check is init
+    if (!m_isInit) {
+        return now + GPSDOG_WAIT_PROCESSING;
+    }
 
-                // send notify that modus is on
-                this->sendNotifySMS();
-            }
+    ////
+    // if Alarm mode is on
+    if (this->isModeOn(GPSDOG_MODE_ALARM)) {
+        // sample fast in alarm
+        if (m_gpsPeriod > GPSDOG_WAIT_GPS_MIN) {
+            this->calcGPSPeriod(true);
         }
 
-        // update position
+        // Time to new send a alarm, a due timer is also consumed without
+        // a fix and the alarm is send with the first fix
+        if ((this->isTimerDue(GPSDOG_TIMER_ALARM, now) || !this->isTimerActive(GPSDOG_TIMER_ALARM)) && m_gpsFix) {
+            this->sendAlarmSMS();
+        }
+    }
+    else {
+        this->stopTimer(GPSDOG_TIMER_ALARM);
+    }
+
+    ////
+    // processing GPS data
+    if (this->isTimerDue(GPSDOG_TIMER_GPSFIX, now)) {
+        // wait time after boot is over, position is fix
+        this->setGpsFix();
+    }
+
+    ////
+    // save runtime state
+    if (this->isTimerDue(GPSDOG_TIMER_SNAP, now)) {
+        this->saveSnapshot(false);
+    }
+
+    ////
+    // retry outbound SMS
+    if (this->isTimerDue(GPSDOG_TIMER_QUEUE, now)) {
+        this->processQueue();
+    }
+
+    ////
+    // update position
+    if (this->isTimerDue(GPSDOG_TIMER_GPS, now)) {
         this->cb_receiveGPS();
+    }
 
-        ////
-        // process command sms
+    ////
+    // process command sms
+    if (m_newSMS) {
+        m_newSMS = false;
         this->cb_checkNewSMS();
+    }
+    else if (this->isTimerDue(GPSDOG_TIMER_SMS, now)) {
+        this->cb_checkNewSMS();
+    }
 
-        ////
-        // wait for next process
-        delay(GPSDOG_WAIT_PROCESSING);
-
-        ////
-        // Check Alarm Overloaded
-        if (m_alarmOverload) {
-            if (m_alarmStartTime > millis()) {
-                m_alarmOverload = false;
-            }
-        }
+    // new SMS arrived while processing
+    if (m_newSMS) {
+        return now;
     }
+
+    return this->getNextDeadline(now, GPSDOG_WAIT_PROCESSING);
 }
 
 void GPSDog::processIncomingSMS()
 {
-    char    *smsCmd;
-    uint8_t count;
-    bool    legalNum;
+    const GD_COMMAND    *cmd;
+    uint8_t             auth;
+    uint8_t             opt;
+    void                (GPSDog::*handler)(uint8_t);
+    bool                legalNum;
 
     // If Protect mode active
     legalNum = this->foundNumberInStore(m_number);
 
+    ////
+    // Fast reject: a unknown number in protect mode can only INIT/RESET
+    if (!legalNum && this->isModeOn(GPSDOG_MODE_PROTECT) && !this->isModeOn(GPSDOG_MODE_FORWARD)) {
+        if (!this->peekSMSCommand(GPSDOG_TXT_INIT) && !this->peekSMSCommand(GPSDOG_TXT_RESET)) {
+            if (m_droppedSMS < 0xFFFF) {
+                m_droppedSMS++;
+            }
+            return;
+        }
+    }
+
     ////
     // Parse Data
-    count   = this->parseSMSMessage();
-    smsCmd  = this->getSMSCommand();
+    this->parseSMSMessage();
 
     ////
     // Find Master command
+    cmd = this->findCommand();
+
+    if (cmd != NULL) {
+        auth = pgm_read_byte(&cmd->m_auth);
 
-    // STATUS
-    if (strncmp_P(smsCmd, GPSDOG_TXT_STATUS, 6) == 0 && count == 0) {
         // check modus for legal number or protected is off
-        if (legalNum || !this->isModeOn(GPSDOG_MODE_PROTECT)) {
-            this->createStatusSMS();
-        }
-        // No Answer
-        else {
+        if (auth == GPSDOG_AUTH_PROTECT && !legalNum && this->isModeOn(GPSDOG_MODE_PROTECT)) {
+            // No Answer
             return;
         }
+        // only for legal number
+        else if (auth == GPSDOG_AUTH_LEGAL && !legalNum) {
+            cmd = NULL;
+        }
     }
-    // INIT pw number sign ON/OFF
-    else if (strncmp_P(smsCmd, GPSDOG_TXT_INIT, 4) == 0 && count == 4) {
-        this->readInitFromSMS();
-    }
-    // RESET pw
-    else if (strncmp_P(smsCmd, GPSDOG_TXT_RESET, 5) == 0 && count == 1) {
-        this->readResetFromSMS();
-    }
-    // STORE idx ADD number sign ON/OFF
-    // STORE idx DEL
-    // STORE idx SHOW
-    else if (legalNum && strncmp_P(smsCmd, GPSDOG_TXT_STORE, 5) == 0 && count >= 2) {
-        this->readStoreFromSMS();
-    }
-    // SET INTERVAL min
-    // SET FORWARD idx
-    // SET GEOFIX VAL
-    // SET UNIT KMH/MPH
-    else if (legalNum && strncmp_P(smsCmd, GPSDOG_TXT_SET, 3) == 0 && count == 2) {
-        this->readSetFromSMS();
-    }
-    // VERSION
-    else if (legalNum && strncmp_P(smsCmd, GPSDOG_TXT_VERSION, 7) == 0 && count == 0) {
-        this->createDefaultSMS(GPSDOG_OPT_SMS_VERSION);
-    }
-    // ALARM ON/OFF/?
-    else if (legalNum && strncmp_P(smsCmd, GPSDOG_TXT_ALARM, 5) == 0 && count == 1) {
-        this->readModeFromSMS(GPSDOG_MODE_ALARM);
-    }
-    // WATCH ON/OFF/?
-    else if (legalNum && strncmp_P(smsCmd, GPSDOG_TXT_WATCH, 5) == 0 && count == 1) {
-        this->readModeFromSMS(GPSDOG_MODE_WATCH);
-    }
-    // PROTECT ON/OFF/?
-    else if (legalNum && strncmp_P(smsCmd, GPSDOG_TXT_PROTECT, 7) == 0 && count == 1) {
-        this->readModeFromSMS(GPSDOG_MODE_PROTECT);
-    }
-    // FORWARD ON/OFF/?
-    else if (legalNum && strncmp_P(smsCmd, GPSDOG_TXT_FORWARD, 7) == 0 && count == 1) {
-        this->readModeFromSMS(GPSDOG_MODE_FORWARD);
-    }
-    // STOP
-    else if (legalNum && strncmp_P(smsCmd, GPSDOG_TXT_STOP, 4) == 0 && count == 0) {
-        // Stop ALARM & WATCH
-        this->setMode(GPSDOG_MODE_ALARM, false);
-        this->setMode(GPSDOG_MODE_WATCH, false);
 
-        this->writeConfig();
-        this->createDefaultSMS(GPSDOG_OPT_SMS_DONE);
+    // Run command
+    if (cmd != NULL) {
+        opt = pgm_read_byte(&cmd->m_opt);
+        memcpy_P(&handler, &cmd->m_handler, sizeof(handler));
+
+        // all changes of the command or nothing
+        this->beginConfig();
+        (this->*handler)(opt);
+        this->commitConfig();
     }
     // Unknown command
     else {
         ////
         // Is forward active, do it!
         if (!legalNum && this->isModeOn(GPSDOG_MODE_FORWARD)) {
-            // restore original message
-            this->cb_reloadSMS();
-
-            // replace number
-            if (!this->setNumber(m_numbers[this->getForwardIdx()])) {
+            // replace number / message is unchanged
+            if (!this->setNumber(this->getStoreNumber(this->getForwardIdx()))) {
                 return;
             }
+
+            // can't generate for retry
+            m_smsKind = GPSDOG_OPT_SMS_NONE;
         }
         // Not unswer to a unknown number
         else if (!legalNum) {
@@ -193,34 +288,176 @@ void GPSDog::processIncomingSMS()
 
     ////
     // Send Answer
-    this->cb_sendSMS();
+    this->sendSMS(false);
+}
+
+const GD_COMMAND* GPSDog::findCommand()
+{
+    char    *smsCmd = this->getParseElement(0);
+    uint8_t size    = this->getParseElementSize(0);
+    uint8_t first;
+
+    // no command
+    if (smsCmd == NULL) {
+        return NULL;
+    }
+
+    ////
+    // Only the commands with the first char & size
+    first = toupper(smsCmd[0]) - 'A';
+
+    if (first >= GPSDOG_CMD_LETTERS) {
+        return NULL;
+    }
+
+    for (uint8_t i = pgm_read_byte(&s_commandIdx[first]); i < pgm_read_byte(&s_commandIdx[first +1]); i++) {
+        const GD_COMMAND *cmd = &s_commands[i];
+
+        // key not match
+        if (pgm_read_byte(&cmd->m_size) != size) {
+            continue;
+        }
+
+        // command found / check parameter count
+        if (strncasecmp_P(smsCmd, cmd->m_name, size) == 0) {
+            if (m_lastParamCount < pgm_read_byte(&cmd->m_minParam) || m_lastParamCount > pgm_read_byte(&cmd->m_maxParam)) {
+                return NULL;
+            }
+
+            return cmd;
+        }
+    }
+
+    return NULL;
 }
 
 void GPSDog::updateGPSData(double latitude, double longitude, double speed, char *date, char *time)
 {
+    int32_t     lat     = lround(latitude * GPSDOG_GPS_GEO_SCALE);
+    int32_t     lon     = lround(longitude * GPSDOG_GPS_GEO_SCALE);
+    uint16_t    val     = 0xFFFF;
+
+    // to 1/100
+    speed *= GPSDOG_GPS_SPEED_SCALE;
+
+    if (speed < 0xFFFF) {
+        val = speed > 0.0 ? speed : 0;
+    }
+
+    this->updateGPSData(lat, lon, val, date, time);
+}
+
+void GPSDog::updateGPSData(double latitude, double longitude, double speed, uint8_t fixType, uint8_t sats, uint16_t hdop, char *date, char *time)
+{
+    int32_t     lat     = lround(latitude * GPSDOG_GPS_GEO_SCALE);
+    int32_t     lon     = lround(longitude * GPSDOG_GPS_GEO_SCALE);
+    uint16_t    val     = 0xFFFF;
+
+    // to 1/100
+    speed *= GPSDOG_GPS_SPEED_SCALE;
+
+    if (speed < 0xFFFF) {
+        val = speed > 0.0 ? speed : 0;
+    }
+
+    this->updateGPSData(lat, lon, val, fixType, sats, hdop, date, time);
+}
+
+void GPSDog::updateGPSData(int32_t latitude, int32_t longitude, uint16_t speed, uint8_t fixType, uint8_t sats, uint16_t hdop, char *date, char *time)
+{
+    // receiver has no position
+    if (fixType < GPSDOG_GPS_FIX_2D) {
+        m_fixSamples ^= m_fixSamples;
+        return;
+    }
+
+    m_goodFix = this->isGoodFix(fixType, sats, hdop);
+    this->updateGPSData(latitude, longitude, speed, date, time);
+
+    ////
+    // Position is fix after some good fixes in a row
+    if (m_gpsFix) {
+        // nothing
+    }
+    else if (!m_goodFix) {
+        m_fixSamples ^= m_fixSamples;
+    }
+    else if (++m_fixSamples >= GPSDOG_GPS_QUALITY_SAMPLES) {
+        this->setGpsFix();
+    }
+
+    m_goodFix = false;
+}
+
+void GPSDog::updateGPSData(int32_t latitude, int32_t longitude, uint16_t speed, char *date, char *time)
+{
+    uint32_t    kmh;
+    bool        outside;
+    bool        moved   = false;
+    GD_SNAP     *snap;
+
+    this->copyDateTime(date, time);
+
+    ////
+    // Filter jumps and jitter
+    if (!this->filterFix(&latitude, &longitude, m_now, this->getFilterSpeed(), this->getFilterMedian())) {
+        // not a good fix in a row
+        m_goodFix = false;
+
+        // check the jump soon
+        this->calcGPSPeriod(true);
+        return;
+    }
+
+    // sample rate
+    this->calcGPSPeriod(this->toMeters(latitude - m_latitude) > GPSDOG_GPS_MOVE || this->toMeters(longitude - m_longitude) > GPSDOG_GPS_MOVE);
+
     ////
     // Copy new Data
     m_latitude  = latitude;
     m_longitude = longitude;
 
+    ////
+    // First fix after reset is near the snapshot, the position is fix
+    if (m_snapCheck) {
+        m_snapCheck = false;
+        snap        = this->getSnap();
+
+        if (!m_gpsFix && this->isInRadius(snap->m_latitude, snap->m_longitude, this->getCosLatitude(snap->m_latitude), latitude, longitude, GPSDOG_SNAP_RADIUS)) {
+            this->setGpsFix();
+        }
+        // good fix far away and out of watch, it is moved while power off
+        else if (!m_gpsFix && m_goodFix && this->isModeOn(GPSDOG_MODE_WATCH) && !this->isModeOn(GPSDOG_MODE_ALARM) && this->isOutsideWatch(latitude, longitude)) {
+            this->setGpsFix();
+            moved = true;
+        }
+    }
+
     // KMH
     if (this->getUnit() == GPSDOG_UNIT_KMH) {
-        m_speed     = speed * 1.6;
+        kmh         = static_cast<uint32_t>(speed) * 16 / 10;
+        m_speed     = kmh < 0xFFFF ? kmh : 0xFFFF;
     }
     // MPH
     else {
         m_speed     = speed;
     }
 
-    this->copyDateTime(date, time);
+    // breadcrumb
+    if (m_gpsFix) {
+        this->addTrack(latitude, longitude, m_now / 1000);
+    }
 
     ////
     // GPSDog Watch ON / Check of state change and position is fix
     if (this->isModeOn(GPSDOG_MODE_WATCH) && !this->isModeOn(GPSDOG_MODE_ALARM) && m_gpsFix) {
 
         // Position change
-        if (!this->cmpGeoData(this->getStoreLatitude(), latitude, this->getStoreGeoFix()) || !this->cmpGeoData(this->getStoreLongitude(), longitude, this->getStoreGeoFix())) {
-            
+        outside = this->isOutsideWatch(latitude, longitude);
+
+        // outside for some fixes in a row or moved while power off
+        if (this->confirmOutside(outside, this->getFilterConfirm()) || moved) {
+
             ////
             // set Alarm
             this->setMode(GPSDOG_MODE_ALARM, true);
@@ -230,19 +467,165 @@ void GPSDog::updateGPSData(double latitude, double longitude, double speed, char
     }
 }
 
+bool GPSDog::sendSMS(bool alarm)
+{
+    uint8_t idx;
+
+    // send is okay
+    if (this->cb_sendSMS()) {
+        return true;
+    }
+
+    // retry only for numbers in store
+    idx = this->getNumberIdxInStore(m_number);
+
+    if (idx < GPSDOG_CONF_NUMBER_STORE && m_smsKind != GPSDOG_OPT_SMS_NONE) {
+        this->pushQueue(idx, m_smsKind, m_smsPayload, alarm, m_now);
+        this->startTimer(GPSDOG_TIMER_QUEUE, m_now, this->getQueueWait(m_now), 0);
+    }
+
+    return false;
+}
+
+void GPSDog::processQueue()
+{
+    uint8_t         pos;
+    GD_QUEUE_ENTRY  *entry;
+    uint32_t        wait    = 0;
+
+    // send all they are due
+    while ((pos = this->getQueueNext(m_now)) != GPSDOG_QUEUE_NONE) {
+        entry = this->getQueueEntry(pos);
+
+        // number is delete from store
+        if (!this->setNumber(this->getStoreNumber(entry->m_numberIdx))) {
+            this->doneQueue(pos);
+            continue;
+        }
+
+        this->createQueueSMS(entry->m_kind, entry->m_payload);
+
+        // send or try later / network is down, stop here
+        if (this->cb_sendSMS()) {
+            this->doneQueue(pos);
+        }
+        else {
+            // the other due entries wait also for the backoff
+            wait = this->failQueue(pos, m_now) ? entry->m_nextTry - m_now : GPSDOG_QUEUE_BACKOFF;
+            break;
+        }
+    }
+
+    // wait for next try
+    if (this->getQueueCount() > 0) {
+        if (this->getQueueWait(m_now) > wait) {
+            wait = this->getQueueWait(m_now);
+        }
+
+        this->startTimer(GPSDOG_TIMER_QUEUE, m_now, wait, 0);
+    }
+}
+
+void GPSDog::createQueueSMS(uint8_t kind, uint8_t payload)
+{
+    switch (kind) {
+        case GPSDOG_OPT_SMS_STATUS :
+            this->createStatusSMS();
+            break;
+        case GPSDOG_OPT_SMS_POWER :
+            this->createPowerSMS();
+            break;
+        case GPSDOG_OPT_SMS_MODE :
+            this->createModeStateSMS(payload);
+            break;
+        case GPSDOG_OPT_SMS_STORESHOW :
+            this->createStoreSMS(payload);
+            break;
+        case GPSDOG_OPT_SMS_GPSFIX :
+            this->createGpsFixSMS();
+            break;
+        case GPSDOG_OPT_SMS_TRACK :
+            this->createTrackSMS(payload);
+            break;
+        default :
+            this->createDefaultSMS(kind);
+            break;
+    }
+}
+
 void GPSDog::sendNotifySMS()
 {
-    // find numbers where have a active notify
-    for (uint8_t i = 0; i < GPSDOG_CONF_NUMBER_STORE; i++) {
+    // no broadcast, send one by one
+    if (cb_broadcastSMS == NULL) {
+        // find numbers where have a active notify
+        for (uint8_t i = 0; i < GPSDOG_CONF_NUMBER_STORE; i++) {
+
+            // Notify is On
+            if (this->isAlarmNotifyOn(i)) {
+                // Send Status SMS
+                if (this->setNumber(this->getStoreNumber(i))) {
+                    this->sendSMS(true);
+                }
+            }
+        }
 
-        // Notify is On
+        return;
+    }
+
+    ////
+    // Collect all recipients
+    m_broadcastCount = 0;
+
+    for (uint8_t i = 0; i < GPSDOG_CONF_NUMBER_STORE; i++) {
         if (this->isAlarmNotifyOn(i)) {
-            // Send Status SMS
-            if (this->setNumber(m_numbers[i])) {
-                this->cb_sendSMS();
-            }
+            m_broadcastIdx[m_broadcastCount++] = i;
         }
     }
+
+    if (m_broadcastCount == 0) {
+        return;
+    }
+
+    // send
+    this->cb_broadcastSMS(m_broadcastCount);
+
+    ////
+    // Retry all they not send
+    for (uint8_t i = 0; i < m_broadcastCount; i++) {
+        if ((m_broadcastIdx[i] & 0x80) == 0x00 && m_smsKind != GPSDOG_OPT_SMS_NONE) {
+            this->pushQueue(m_broadcastIdx[i], m_smsKind, m_smsPayload, true, m_now);
+
+            // network is down, the due entries wait also
+            this->startTimer(GPSDOG_TIMER_QUEUE, m_now, GPSDOG_QUEUE_BACKOFF, 0);
+        }
+    }
+
+    m_broadcastCount = 0;
+}
+
+bool GPSDog::loadBroadcastNumber(uint8_t idx)
+{
+    // index secure
+    if (idx >= m_broadcastCount) {
+        return false;
+    }
+
+    return this->setNumber(this->getStoreNumber(m_broadcastIdx[idx] & 0x7F));
+}
+
+void GPSDog::setBroadcastResult(uint8_t idx, bool send)
+{
+    // index secure
+    if (idx >= m_broadcastCount) {
+        return;
+    }
+
+    if (send) {
+        m_broadcastIdx[idx] |= 0x80;
+    }
+    else {
+        m_broadcastIdx[idx] &= 0x7F;
+    }
 }
 
 void GPSDog::sendAlarmSMS()
@@ -250,6 +633,9 @@ void GPSDog::sendAlarmSMS()
     // calc next alarm SMS
     this->calcNextAlarm();
 
+    // keep schedule over a reset
+    this->saveSnapshot(true);
+
     // generate Status SMS Text
     this->createStatusSMS();
 
@@ -261,20 +647,16 @@ void GPSDog::sendAlarmSMS()
 void GPSDog::calcNextAlarm()
 {
     uint32_t interVal   = static_cast<uint32_t>(this->getAlarmInterval());
-    
+
+    // old config can have 0
+    if (interVal == 0) {
+        interVal = 1;
+    }
+
     // calc milliseconds
     interVal *= 60000;
 
-    m_alarmStartTime    = millis();
-    m_nextAlarmSMS      = m_alarmStartTime + interVal;
-
-    // overloaded
-    if (m_nextAlarmSMS < m_alarmStartTime) {
-       m_alarmOverload = true;
-    }
-    else {
-       m_alarmOverload = false;
-    }
+    this->startTimer(GPSDOG_TIMER_ALARM, m_now, interVal, 0);
 }
 
 void GPSDog::createStatusSMS()
@@ -310,6 +692,114 @@ void GPSDog::createStatusSMS()
     ////
     // create SMS Text
     snprintf_P(m_message, m_messageSize -1, GPSDOG_SMS_STATUS, stat, lat, lon, speed, m_date, m_time, lat, lon);
+
+    m_smsKind       = GPSDOG_OPT_SMS_STATUS;
+    m_smsPayload    = 0x00;
+}
+
+void GPSDog::createPowerSMS()
+{
+    // init buffer sms text
+    if (!this->cleanSMS()) {
+        return;
+    }
+
+    snprintf_P(m_message, m_messageSize -1, GPSDOG_SMS_POWER, static_cast<unsigned long>(this->getAwakeTime()), static_cast<unsigned long>(this->getSleepTime()));
+
+    m_smsKind       = GPSDOG_OPT_SMS_POWER;
+    m_smsPayload    = 0x00;
+}
+
+void GPSDog::createStoreSMS(uint8_t idx)
+{
+    char    onOff[4];
+    uint8_t sign        = this->getSignNumber(idx);
+
+    // init notify txt
+    this->textOnOff(onOff, 4, this->isAlarmNotifyOn(idx));
+
+    // init buffer sms text
+    if (!this->cleanSMS()) {
+        return;
+    }
+
+    // write
+    snprintf_P(m_message, m_messageSize -1, GPSDOG_SMS_STORESHOW, this->getStoreNumber(idx), sign, onOff);
+
+    m_smsKind       = GPSDOG_OPT_SMS_STORESHOW;
+    m_smsPayload    = idx;
+}
+
+void GPSDog::createTrackSMS(uint8_t count)
+{
+    GD_TRACK_POINT  points[GPSDOG_TRACK_SMS_MAX];
+    char            lat[12];
+    char            lon[12];
+    uint16_t        size;
+    uint16_t        pos;
+    uint8_t         first;
+
+    // init buffer sms text
+    if (!this->cleanSMS()) {
+        return;
+    }
+
+    if (count > GPSDOG_TRACK_SMS_MAX) {
+        count = GPSDOG_TRACK_SMS_MAX;
+    }
+
+    count = this->getTrack(points, count);
+    first = count;
+
+    ////
+    // Newest points they fit / space for the header
+    size = 20;
+
+    while (first > 0) {
+        size += writeFixed(lat, 12, points[first -1].m_latitude, GPSDOG_TRACK_DIGITS);
+        size += writeFixed(lon, 12, points[first -1].m_longitude, GPSDOG_TRACK_DIGITS) + 2;
+
+        if (size >= m_messageSize) {
+            break;
+        }
+
+        first--;
+    }
+
+    ////
+    // create SMS Text
+    snprintf_P(m_message, m_messageSize -1, GPSDOG_SMS_TRACK, static_cast<unsigned long>(first < count ? (m_now / 1000 - points[first].m_time) / 60 : 0));
+
+    for (pos = strlen(m_message); first < count; first++) {
+        writeFixed(lat, 12, points[first].m_latitude, GPSDOG_TRACK_DIGITS);
+        writeFixed(lon, 12, points[first].m_longitude, GPSDOG_TRACK_DIGITS);
+
+        pos += snprintf(m_message + pos, m_messageSize - 1 - pos, "\x0A%s,%s", lat, lon);
+    }
+
+    m_smsKind       = GPSDOG_OPT_SMS_TRACK;
+    m_smsPayload    = count;
+}
+
+void GPSDog::createGpsFixSMS()
+{
+    uint32_t timeDone = this->getTimeLeft(GPSDOG_TIMER_GPSFIX, m_now);
+
+    // Calc in sec
+    if (timeDone < 1000) {
+        timeDone = 1;
+    }
+    else {
+        timeDone /= 1000;
+    }
+
+    // generate message
+    if (this->cleanSMS()) {
+        snprintf_P(m_message, m_messageSize -1, GPSDOG_SMS_GPSFIX, static_cast<unsigned long>(timeDone));
+    }
+
+    m_smsKind       = GPSDOG_OPT_SMS_GPSFIX;
+    m_smsPayload    = 0x00;
 }
 
 void GPSDog::createDefaultSMS(uint8_t msgOpt)
@@ -319,6 +809,9 @@ void GPSDog::createDefaultSMS(uint8_t msgOpt)
         return;
     }
 
+    m_smsKind       = msgOpt;
+    m_smsPayload    = 0x00;
+
     switch (msgOpt) {
         case GPSDOG_OPT_SMS_DONE :
             strncpy_P(m_message, GPSDOG_SMS_DONE, m_messageSize -1);
@@ -348,7 +841,21 @@ void GPSDog::createModeStateSMS(uint8_t mode)
 
     // Init mode name
     memset(modeName, 0x00, 8);
-    strncpy(modeName, this->getParseElement(0), 7);
+
+    switch (mode) {
+        case GPSDOG_MODE_ALARM :
+            strncpy_P(modeName, GPSDOG_TXT_ALARM, 7);
+            break;
+        case GPSDOG_MODE_WATCH :
+            strncpy_P(modeName, GPSDOG_TXT_WATCH, 7);
+            break;
+        case GPSDOG_MODE_PROTECT :
+            strncpy_P(modeName, GPSDOG_TXT_PROTECT, 7);
+            break;
+        case GPSDOG_MODE_FORWARD :
+            strncpy_P(modeName, GPSDOG_TXT_FORWARD, 7);
+            break;
+    }
 
     // init notify txt
     this->textOnOff(onOff, 4, this->isModeOn(mode));
@@ -360,18 +867,15 @@ void GPSDog::createModeStateSMS(uint8_t mode)
 
     // generate text
     snprintf_P(m_message, m_messageSize -1, GPSDOG_SMS_MODE, modeName, onOff);
+
+    m_smsKind       = GPSDOG_OPT_SMS_MODE;
+    m_smsPayload    = mode;
 }
 
 bool GPSDog::parseOnOff(uint8_t idx)
 {
-    char *onOff = this->getParseElementUpper(idx);
-
     // ON
-    if (strncmp_P(onOff, GPSDOG_TXT_ON, 2) == 0) {
-        return true;
-    }
-
-    return false;
+    return this->cmpParseElement(idx, GPSDOG_TXT_ON);
 }
 
 void GPSDog::textOnOff(char *buffer, uint8_t size, bool onOff)
@@ -388,6 +892,48 @@ void GPSDog::textOnOff(char *buffer, uint8_t size, bool onOff)
     }
 }
 
+void GPSDog::readInfoFromSMS(uint8_t opt)
+{
+    switch (opt) {
+        case GPSDOG_OPT_SMS_STATUS :
+            this->createStatusSMS();
+            break;
+        case GPSDOG_OPT_SMS_POWER :
+            this->createPowerSMS();
+            break;
+        default :
+            this->createDefaultSMS(opt);
+            break;
+    }
+}
+
+void GPSDog::readTrackFromSMS(uint8_t opt)
+{
+    uint32_t count = GPSDOG_TRACK_SMS_MAX;
+
+    // TRACK count
+    if (m_lastParamCount == 1) {
+        count = strtoul(this->getParseElement(1), NULL, 10);
+
+        if (count == 0 || count > GPSDOG_TRACK_SMS_MAX) {
+            this->createDefaultSMS(GPSDOG_OPT_SMS_ERROR);
+            return;
+        }
+    }
+
+    this->createTrackSMS(static_cast<uint8_t>(count));
+}
+
+void GPSDog::readStopFromSMS(uint8_t opt)
+{
+    // Stop ALARM & WATCH
+    this->setMode(GPSDOG_MODE_ALARM, false);
+    this->setMode(GPSDOG_MODE_WATCH, false);
+    this->resetOutside();
+
+    this->createDefaultSMS(GPSDOG_OPT_SMS_DONE);
+}
+
 void GPSDog::readModeFromSMS(uint8_t mode)
 {
     char *opt = this->getParseElement(1);
@@ -414,15 +960,12 @@ void GPSDog::readModeFromSMS(uint8_t mode)
         this->setMode(mode, onOff);
         this->createDefaultSMS(GPSDOG_OPT_SMS_DONE);
     }
-
-    // save
-    this->writeConfig();
 }
 
-void GPSDog::readInitFromSMS()
+void GPSDog::readInitFromSMS(uint8_t opt)
 {
-    char    *pw         = this->getParseElement(1);
-    char    *number     = this->getParseElement(2);
+    char    pw[GPSDOG_CONF_PW_SIZE +1];
+    char    number[GPSDOG_CONF_NUM_SIZE +1];
     uint8_t sign        = atoi(this->getParseElement(3));
     bool    alarmNotify = this->parseOnOff(4);
 
@@ -431,8 +974,8 @@ void GPSDog::readInitFromSMS()
         goto Error;
     }
 
-    // set number to first store
-    if (!this->addNumberWithNotify(0, number, sign, alarmNotify)) {
+    // read password & number
+    if (!this->copyParseElement(1, pw, GPSDOG_CONF_PW_SIZE +1) || !this->copyParseElement(2, number, GPSDOG_CONF_NUM_SIZE +1)) {
         goto Error;
     }
 
@@ -441,64 +984,108 @@ void GPSDog::readInitFromSMS()
         goto Error;
     }
 
-    // write config
-    this->writeConfig();
+    // set number to first store (staged, it is written on commit)
+    if (!this->addNumberWithNotify(0, number, sign, alarmNotify)) {
+        goto Error;
+    }
+
     this->createDefaultSMS(GPSDOG_OPT_SMS_INIT);
     return;
 
 Error:
-    this->readConfig();
+    this->abortConfig();
     this->createDefaultSMS(GPSDOG_OPT_SMS_ERROR);
     return;
 }
 
-void GPSDog::readResetFromSMS()
+void GPSDog::readResetFromSMS(uint8_t opt)
 {
-    char *pw = this->getParseElement(1);
+    char pw[GPSDOG_CONF_PW_SIZE +1];
 
     // init mode is set and passsword is okay
-    if (!this->isModeOn(GPSDOG_MODE_INIT) || !this->checkPassword(pw)) {
+    if (!this->isModeOn(GPSDOG_MODE_INIT) || !this->copyParseElement(1, pw, GPSDOG_CONF_PW_SIZE +1) || !this->checkPassword(pw)) {
         this->createDefaultSMS(GPSDOG_OPT_SMS_ERROR);
         return;
     }
 
     // reset config
     this->cleanConfig();
-
-    // save config
-    this->writeConfig();
+    this->cleanFence();
+    this->cleanSnap();
+    this->cleanTrack();
 
     // end
     this->createDefaultSMS(GPSDOG_OPT_SMS_DONE);
 }
 
-void GPSDog::readSetFromSMS()
+void GPSDog::readSetFromSMS(uint8_t opt)
 {
-    char    *cmd    = this->getParseElementUpper(1);
-    char    *opt    = this->getParseElement(2);
+    char    *val    = this->getParseElement(2);
 
     // SET INTERVAL min
-    if (strncmp_P(cmd, GPSDOG_TXT_INTERVAL, 8) == 0) {
-        this->setAlarmInterval(atoi(opt));
+    if (this->cmpParseElement(1, GPSDOG_TXT_INTERVAL)) {
+        uint32_t interval = strtoul(val, NULL, 10);
+
+        // 0 send a alarm SMS on every tick
+        if (interval == 0 || interval > GPSDOG_CONF_ALARM_INTERVAL_MAX) {
+            goto Error;
+        }
+
+        this->setAlarmInterval(interval);
     }
     // SET FORWARD idx
-    else if (strncmp_P(cmd, GPSDOG_TXT_FORWARD, 7) == 0) {
-        this->setForwardIdx(atoi(opt) -1);
+    else if (this->cmpParseElement(1, GPSDOG_TXT_FORWARD)) {
+        this->setForwardIdx(atoi(val) -1);
     }
-    // SET GEOFIX VAL
-    else if (strncmp_P(cmd, GPSDOG_TXT_GEOFIX, 6) == 0) {
-        this->setStoreGeoFix(atof(opt));
+    // SET GEOFIX meters
+    else if (this->cmpParseElement(1, GPSDOG_TXT_GEOFIX)) {
+        uint32_t radius = strtoul(val, NULL, 10);
+
+        if (radius == 0 || radius > GPSDOG_GPS_RADIUS_MAX) {
+            goto Error;
+        }
+
+        this->setStoreGeoRadius(radius);
     }
-    // SET UNIT KMH/MPH
-    else if (strncmp_P(cmd, GPSDOG_TXT_UNIT, 4) == 0) {
-        opt    = this->getParseElementUpper(2);
+    // SET CONFIRM fixes
+    else if (this->cmpParseElement(1, GPSDOG_TXT_CONFIRM)) {
+        uint8_t confirm = atoi(val);
+
+        if (confirm == 0 || confirm > GPSDOG_FILTER_CONFIRM_MAX) {
+            goto Error;
+        }
 
+        this->setFilterConfirm(confirm);
+    }
+    // SET MAXSPEED kmh (0 is off)
+    else if (this->cmpParseElement(1, GPSDOG_TXT_MAXSPEED)) {
+        uint32_t speed = strtoul(val, NULL, 10);
+
+        if (speed > GPSDOG_FILTER_SPEED_MAX) {
+            goto Error;
+        }
+
+        this->setFilterSpeed(speed);
+    }
+    // SET MEDIAN window (1 is off)
+    else if (this->cmpParseElement(1, GPSDOG_TXT_MEDIAN)) {
+        uint8_t median = atoi(val);
+
+        // only odd windows have a middle
+        if (median == 0 || median > GPSDOG_FILTER_MEDIAN_MAX || median % 2 == 0) {
+            goto Error;
+        }
+
+        this->setFilterMedian(median);
+    }
+    // SET UNIT KMH/MPH
+    else if (this->cmpParseElement(1, GPSDOG_TXT_UNIT)) {
         // KMH
-        if (strncmp_P(opt, GPSDOG_TXT_KMH, 3) == 0) {
+        if (this->cmpParseElement(2, GPSDOG_TXT_KMH)) {
             this->setUnit(GPSDOG_UNIT_KMH);
         }
         // MPH
-        else if (strncmp_P(opt, GPSDOG_TXT_MPH, 3) == 0) {
+        else if (this->cmpParseElement(2, GPSDOG_TXT_MPH)) {
             this->setUnit(GPSDOG_UNIT_MPH);
         }
         // ERROR
@@ -511,7 +1098,6 @@ void GPSDog::readSetFromSMS()
         goto Error;
     }
 
-    this->writeConfig();
     this->createDefaultSMS(GPSDOG_OPT_SMS_DONE);
     return;
 
@@ -520,10 +1106,9 @@ Error:
     return;
 }
 
-void GPSDog::readStoreFromSMS()
+void GPSDog::readStoreFromSMS(uint8_t opt)
 {
     uint8_t idx     = atoi(this->getParseElement(1)) -1;
-    char    *cmd    = this->getParseElementUpper(2);
 
     // Store number in range
     if (idx >= GPSDOG_CONF_NUMBER_STORE || idx < 0x00) {
@@ -531,13 +1116,13 @@ void GPSDog::readStoreFromSMS()
     }
 
     // STORE num ADD number sign ON/OFF
-    if (strncmp_P(cmd, GPSDOG_TXT_ADD, 3) == 0 && m_lastParamCount == 5) {
-        char    *number = this->getParseElement(3);
+    if (this->cmpParseElement(2, GPSDOG_TXT_ADD) && m_lastParamCount == 5) {
+        char    number[GPSDOG_CONF_NUM_SIZE +1];
         uint8_t sign    = atoi(this->getParseElement(4));
         bool    notify  = this->parseOnOff(5);
     
         // Ckeck number is set
-        if (!this->addNumberWithNotify(idx, number, sign, notify)) {
+        if (!this->copyParseElement(3, number, GPSDOG_CONF_NUM_SIZE +1) || !this->addNumberWithNotify(idx, number, sign, notify)) {
             goto Error;
         }
        
@@ -545,38 +1130,181 @@ void GPSDog::readStoreFromSMS()
         goto Done;
     }
     // STORE num DEL
-    else if (strncmp_P(cmd, GPSDOG_TXT_DEL, 3) == 0 && m_lastParamCount == 2) {
+    else if (this->cmpParseElement(2, GPSDOG_TXT_DEL) && m_lastParamCount == 2) {
         // clean number
-        memset(m_numbers[idx], 0x00, GPSDOG_CONF_NUM_SIZE +1);
-        this->setAlarmNotify(idx, false);
+        this->delStoreNumber(idx);
 
         // end
         goto Done;
     }
     // STORE num SHOW
-    else if (strncmp_P(cmd, GPSDOG_TXT_SHOW, 4) == 0 && m_lastParamCount == 2) {
-        char    onOff[4];
-        uint8_t sign        = this->getSignNumber(idx);
-
-        // init notify txt
-        this->textOnOff(onOff, 4, this->isAlarmNotifyOn(idx));
-        
-        // write
-        snprintf_P(m_message, m_messageSize -1, GPSDOG_SMS_STORESHOW, m_numbers[idx], sign, onOff);
+    else if (this->cmpParseElement(2, GPSDOG_TXT_SHOW) && m_lastParamCount == 2) {
+        this->createStoreSMS(idx);
         return;
     }
 
 Error:
-    this->readConfig();
+    this->abortConfig();
+    this->createDefaultSMS(GPSDOG_OPT_SMS_ERROR);
+    return;
+
+Done:
+    this->createDefaultSMS(GPSDOG_OPT_SMS_DONE);
+    return;
+}
+
+void GPSDog::readZoneFromSMS(uint8_t opt)
+{
+    uint8_t idx = atoi(this->getParseElement(1)) -1;
+    int32_t lat[GPSDOG_FENCE_POINTS];
+    int32_t lon[GPSDOG_FENCE_POINTS];
+    uint8_t count;
+
+    // ZONE idx CIRCLE lat,lon meters
+    if (this->cmpParseElement(2, GPSDOG_TXT_CIRCLE) && m_lastParamCount == 4) {
+        uint32_t radius = strtoul(this->getParseElement(4), NULL, 10);
+
+        if (!this->parseGeoPoint(this->getParseElement(3), this->getParseElementSize(3), &lat[0], &lon[0])) {
+            goto Error;
+        }
+        if (radius > GPSDOG_GPS_RADIUS_MAX || !this->setFenceCircle(idx, lat[0], lon[0], radius)) {
+            goto Error;
+        }
+
+        goto Done;
+    }
+    // ZONE idx POLY lat,lon lat,lon lat,lon ...
+    else if (this->cmpParseElement(2, GPSDOG_TXT_POLY) && m_lastParamCount >= 5) {
+        count = m_lastParamCount -2;
+
+        for (uint8_t i = 0; i < count; i++) {
+            if (!this->parseGeoPoint(this->getParseElement(i +3), this->getParseElementSize(i +3), &lat[i], &lon[i])) {
+                goto Error;
+            }
+        }
+
+        if (!this->setFencePolygon(idx, lat, lon, count)) {
+            goto Error;
+        }
+
+        goto Done;
+    }
+    // ZONE idx DEL
+    else if (this->cmpParseElement(2, GPSDOG_TXT_DEL) && m_lastParamCount == 2 && idx < GPSDOG_FENCE_COUNT) {
+        this->delFence(idx);
+        goto Done;
+    }
+
+Error:
+    // zones are written direct and not part of the config transaction
+    this->abortConfig();
     this->createDefaultSMS(GPSDOG_OPT_SMS_ERROR);
     return;
 
 Done:
-    this->writeConfig();
     this->createDefaultSMS(GPSDOG_OPT_SMS_DONE);
     return;
 }
 
+void GPSDog::setGpsFix()
+{
+    m_gpsFix = true;
+
+    // timeout is not needed
+    this->stopTimer(GPSDOG_TIMER_GPSFIX);
+
+    // if GPSDog wait for watching out
+    if (this->isModeOn(GPSDOG_MODE_DOWATCH)) {
+        this->doWatching();
+
+        // Reset state & save
+        this->setMode(GPSDOG_MODE_DOWATCH, false);
+        this->writeConfig();
+
+        // send notify that modus is on
+        this->sendNotifySMS();
+    }
+}
+
+void GPSDog::calcGPSPeriod(bool moved)
+{
+    uint32_t period = GPSDOG_WAIT_GPS_MIN;
+
+    // back off while the position is the same
+    if (!moved && m_gpsFix && !this->isModeOn(GPSDOG_MODE_ALARM)) {
+        period = m_gpsPeriod * 2;
+
+        if (period > GPSDOG_WAIT_GPS_MAX) {
+            period = GPSDOG_WAIT_GPS_MAX;
+        }
+    }
+
+    // restart timer only if it is changed
+    if (period != m_gpsPeriod) {
+        m_gpsPeriod = period;
+        this->startTimer(GPSDOG_TIMER_GPS, m_now, period, period);
+    }
+}
+
+void GPSDog::restoreSnapshot()
+{
+    GD_SNAP *snap;
+
+    if (!this->loadSnap()) {
+        return;
+    }
+
+    snap        = this->getSnap();
+    m_snapCheck = (snap->m_flags & GPSDOG_SNAP_FIX) != 0;
+
+    // continue the alarm SMS schedule
+    if (this->isModeOn(GPSDOG_MODE_ALARM) && (snap->m_flags & GPSDOG_SNAP_ALARM)) {
+        this->startTimer(GPSDOG_TIMER_ALARM, m_now, snap->m_alarmLeft * 1000UL, 0);
+    }
+}
+
+void GPSDog::saveSnapshot(bool force)
+{
+    GD_SNAP     *snap   = this->getSnap();
+    uint8_t     flags   = GPSDOG_SNAP_FIX;
+    uint32_t    left    = 0;
+
+    // only a good position / bounded write rate (0 is never written)
+    if (!m_gpsFix || (m_snapTime != 0 && !GDTimer::isReached(m_snapTime + GPSDOG_WAIT_SNAP_MIN, m_now))) {
+        return;
+    }
+
+    // alarm schedule
+    if (this->isModeOn(GPSDOG_MODE_ALARM) && this->isTimerActive(GPSDOG_TIMER_ALARM)) {
+        flags   |= GPSDOG_SNAP_ALARM;
+        left    = this->getTimeLeft(GPSDOG_TIMER_ALARM, m_now) / 1000;
+    }
+
+    // nothing is changed
+    if (!force && flags == GPSDOG_SNAP_FIX && snap->m_flags == flags && this->isInRadius(snap->m_latitude, snap->m_longitude, this->getCosLatitude(snap->m_latitude), m_latitude, m_longitude, GPSDOG_SNAP_RADIUS)) {
+        return;
+    }
+
+    this->writeSnap(flags, m_latitude, m_longitude, left < 0xFFFF ? left : 0xFFFF);
+    m_snapTime = m_now;
+
+    // keep the way of a alarm, own write rate (0 is never written)
+    if ((flags & GPSDOG_SNAP_ALARM) && this->isTrackChanged() && (m_trackTime == 0 || GDTimer::isReached(m_trackTime + GPSDOG_WAIT_TRACK_MIN, m_now))) {
+        this->saveTrack();
+        m_trackTime = m_now;
+    }
+}
+
+bool GPSDog::isOutsideWatch(int32_t latitude, int32_t longitude)
+{
+    // after boot
+    if (m_watchCos == 0) {
+        m_watchCos = this->getCosLatitude(this->getStoreLatitude());
+    }
+
+    return !this->isInRadius(this->getStoreLatitude(), this->getStoreLongitude(), m_watchCos, latitude, longitude, this->getStoreGeoRadius()) && !this->isInFence(latitude, longitude);
+}
+
 void GPSDog::doWatching()
 {
     // Postion is fix / save this GPS Data
@@ -584,25 +1312,17 @@ void GPSDog::doWatching()
         this->setStoreLatitude(m_latitude);
         this->setStoreLongitude(m_longitude);
 
+        m_watchCos = this->getCosLatitude(m_latitude);
+
+        // outside fixes of the old point
+        this->resetOutside();
+
         this->setMode(GPSDOG_MODE_WATCH, true);
         this->createDefaultSMS(GPSDOG_OPT_SMS_WATCH);
     }
     // if GPS is not Fix, you can start watch modus later
     else {
-        uint32_t timeDone = GPSDOG_WAIT_GPSFIX - millis();
-
-        // Calc in sec
-        if (timeDone < 1000) {
-            timeDone = 1;
-        }
-        else {
-            timeDone /= 1000;
-        }
-
-        // generate message
-        if (this->cleanSMS()) {
-            snprintf_P(m_message, m_messageSize -1, GPSDOG_SMS_GPSFIX, timeDone);
-        }
+        this->createGpsFixSMS();
 
         this->setMode(GPSDOG_MODE_DOWATCH, true);
         return;
@@ -12,24 +12,27 @@
 #include "core/GDConfig.h"
 #include "core/GDSms.h"
 #include "core/GDGps.h"
+#include "core/GDTimer.h"
+#include "core/GDPower.h"
+#include "core/GDQueue.h"
+#include "core/GDFence.h"
+#include "core/GDFilter.h"
+#include "core/GDSnap.h"
+#include "core/GDTrack.h"
 
 // ASCII
 #define GPSDOG_CHAR_ASK 0x3f
 
 // String
 #define GPSDOG_TXT_STATUS PSTR("STATUS")
-#define GPSDOG_TXT_STORE PSTR("STORE")
 #define GPSDOG_TXT_ALARM PSTR("ALARM")
-#define GPSDOG_TXT_PROTECT PSTR("PROTECT")
 #define GPSDOG_TXT_WATCH PSTR("WATCH")
+#define GPSDOG_TXT_PROTECT PSTR("PROTECT")
 #define GPSDOG_TXT_INIT PSTR("INIT")
 #define GPSDOG_TXT_RESET PSTR("RESET")
-#define GPSDOG_TXT_SET PSTR("SET")
 #define GPSDOG_TXT_INTERVAL PSTR("INTERVAL")
 #define GPSDOG_TXT_GEOFIX PSTR("GEOFIX")
 #define GPSDOG_TXT_FORWARD PSTR("FORWARD")
-#define GPSDOG_TXT_VERSION PSTR("VERSION")
-#define GPSDOG_TXT_STOP PSTR("STOP")
 #define GPSDOG_TXT_ADD PSTR("ADD")
 #define GPSDOG_TXT_DEL PSTR("DEL")
 #define GPSDOG_TXT_SHOW PSTR("SHOW")
@@ -38,6 +41,11 @@
 #define GPSDOG_TXT_KMH PSTR("KMH")
 #define GPSDOG_TXT_MPH PSTR("MPH")
 #define GPSDOG_TXT_UNIT PSTR("UNIT")
+#define GPSDOG_TXT_CIRCLE PSTR("CIRCLE")
+#define GPSDOG_TXT_POLY PSTR("POLY")
+#define GPSDOG_TXT_CONFIRM PSTR("CONFIRM")
+#define GPSDOG_TXT_MAXSPEED PSTR("MAXSPEED")
+#define GPSDOG_TXT_MEDIAN PSTR("MEDIAN")
 
 #define GPSDOG_SMS_VERSION PSTR("GPSDog version: 2")
 #define GPSDOG_SMS_STORESHOW PSTR("Number: %s\x0A" \
@@ -54,20 +62,96 @@
                                "Speed: %s\x0A" \
                                "Period: %s %s\x0A" \
                                "https://maps.google.com/maps?q=%s,%s")
-#define GPSDOG_SMS_GPSFIX PSTR("It wait until GPS position is fix. That is in %d Sec.")
+#define GPSDOG_SMS_GPSFIX PSTR("It wait until GPS position is fix. That is in max. %lu Sec.")
 #define GPSDOG_SMS_WATCH PSTR("GPSDog is now watching")
+#define GPSDOG_SMS_POWER PSTR("Awake: %lu Sec.\x0A" \
+                              "Sleep: %lu Sec.")
+#define GPSDOG_SMS_TRACK PSTR("Track: %lu min")
 
 // opt
+#define GPSDOG_OPT_SMS_NONE 0x00
 #define GPSDOG_OPT_SMS_DONE 0x01
 #define GPSDOG_OPT_SMS_ERROR 0x02
 #define GPSDOG_OPT_SMS_UNKNOWN 0x03
 #define GPSDOG_OPT_SMS_INIT 0x04
 #define GPSDOG_OPT_SMS_VERSION 0x05
 #define GPSDOG_OPT_SMS_WATCH 0x06
+#define GPSDOG_OPT_SMS_STATUS 0x07
+#define GPSDOG_OPT_SMS_POWER 0x08
+#define GPSDOG_OPT_SMS_MODE 0x09
+#define GPSDOG_OPT_SMS_STORESHOW 0x0A
+#define GPSDOG_OPT_SMS_GPSFIX 0x0B
+#define GPSDOG_OPT_SMS_TRACK 0x0C
+
+// command auth
+#define GPSDOG_AUTH_NONE 0x00 // every number
+#define GPSDOG_AUTH_PROTECT 0x01 // number in store or protect off
+#define GPSDOG_AUTH_LEGAL 0x02 // number in store
+
+// command
+#define GPSDOG_CMD_NAME_SIZE 7
+#define GPSDOG_CMD_LETTERS 26 // A - Z
 
 // config
 #define GPSDOG_WAIT_PROCESSING 30000 // 30sec
+#define GPSDOG_WAIT_SMS 1000 // 1sec
+#define GPSDOG_WAIT_SMS_SIGNAL 300000 // 5min
 #define GPSDOG_WAIT_GPSFIX 300000 // 5min
+#define GPSDOG_WAIT_SNAP 600000 // 10min
+#define GPSDOG_WAIT_SNAP_MIN 60000 // 1min
+#define GPSDOG_WAIT_TRACK_MIN 900000 // 15min
+
+// GPS sample period, it back off while the position is the same
+#ifndef GPSDOG_WAIT_GPS_MIN
+#define GPSDOG_WAIT_GPS_MIN 10000 // 10sec
+#endif
+#ifndef GPSDOG_WAIT_GPS_MAX
+#define GPSDOG_WAIT_GPS_MAX 120000 // 2min
+#endif
+
+// position is moved over this meters between two samples
+#define GPSDOG_GPS_MOVE 40
+
+// max track points in one SMS
+#define GPSDOG_TRACK_SMS_MAX 10
+
+// snapshot position is the same in this radius (meters)
+#define GPSDOG_SNAP_RADIUS 100
+
+// timer
+#define GPSDOG_TIMER_ALARM 0x00
+#define GPSDOG_TIMER_GPSFIX 0x01
+#define GPSDOG_TIMER_GPS 0x02
+#define GPSDOG_TIMER_SMS 0x03
+#define GPSDOG_TIMER_QUEUE 0x04
+#define GPSDOG_TIMER_SNAP 0x05
+
+class GPSDog;
+
+/**
+ * Entry of SMS command table (PROGMEM)
+ */
+struct GD_COMMAND
+{
+    /** Command name in uppercase */
+    char    m_name[GPSDOG_CMD_NAME_SIZE +1];
+
+    /** Length of command name, is the key in the first char index */
+    uint8_t m_size;
+
+    /** Range of parameter count */
+    uint8_t m_minParam;
+    uint8_t m_maxParam;
+
+    /** Auth for this command @see GPSDOG_AUTH_LEGAL */
+    uint8_t m_auth;
+
+    /** Option for the handler */
+    uint8_t m_opt;
+
+    /** Handler for this command */
+    void    (GPSDog::*m_handler)(uint8_t opt);
+};
 
 /**
  * Object for GPSDog config
@@ -75,26 +159,82 @@
 class GPSDog :
     protected GDConfig,
     protected GDGps,
-    protected GDSms
+    protected GDSms,
+    protected GDTimer,
+    protected GDPower,
+    protected GDQueue,
+    protected GDFence,
+    protected GDFilter,
+    protected GDSnap,
+    protected GDTrack
 {
     private:
 
+        /** SMS command table */
+        static const GD_COMMAND s_commands[];
+
+        /** Index of @see s_commands by first char */
+        static const uint8_t s_commandIdx[];
+
         /** All callback function and buffer are set */
         bool        m_isInit;
 
         /** Is position correct after boot */
         bool        m_gpsFix;
 
-        /** Millis value of next alarm processing */
-        uint32_t    m_nextAlarmSMS;
-        uint32_t    m_alarmStartTime;
-        bool        m_alarmOverload;
+        /** Count of good fixes in a row @see GDGps::isGoodFix */
+        uint8_t     m_fixSamples;
+
+        /** Fix in @see updateGPSData is good, only the quality call set it and the jump filter clear it */
+        bool        m_goodFix;
+
+        /** First fix after boot is compared with the snapshot */
+        bool        m_snapCheck;
+
+        /** Millis value of last snapshot write */
+        uint32_t    m_snapTime;
+
+        /** Millis value of last track write */
+        uint32_t    m_trackTime;
+
+        /** Period of GPS timer in ms */
+        uint32_t    m_gpsPeriod;
+
+        /** Sleep between the work in @see mainProcessing */
+        bool        m_idleMode;
+
+        /** Count of SMS they drop from unknown numbers */
+        uint16_t    m_droppedSMS;
+
+        /** Millis value of the running @see tick, all timing use this clock */
+        uint32_t    m_now;
+
+        /** A new SMS is signaled from @see signalNewSMS */
+        volatile bool m_newSMS;
+
+        /** Kind and option of the SMS text in buffer for @see createQueueSMS */
+        uint8_t     m_smsKind;
+        uint8_t     m_smsPayload;
+
+        /** Store index of broadcast recipients, bit 7 is set if send */
+        uint8_t     m_broadcastIdx[GPSDOG_CONF_NUMBER_STORE];
+        uint8_t     m_broadcastCount;
+
+        /** cos of watch latitude as Q14, 0 is not calc */
+        uint16_t    m_watchCos;
 
         /**
          * Callback for sending SMS with GPSDog.
          * @return              TRUE / FALSE if message send.
          */
-        void (*cb_sendSMS)();
+        bool (*cb_sendSMS)();
+
+        /**
+         * Callback for sending the SMS buffer to many recipients. Load
+         * every number with @see loadBroadcastNumber and report the
+         * state with @see setBroadcastResult. It can be NULL.
+         */
+        void (*cb_broadcastSMS)(uint8_t count);
 
         /**
          * Callback for check new SMS. Load every new message and
@@ -103,18 +243,34 @@ class GPSDog :
          */
         void (*cb_checkNewSMS)();
 
-        /**
-         * Callback for reload a SMS buffer. It use it for forward a SMS
-         * after parse the SMS boddy.
-         */
-        void (*cb_reloadSMS)();
-
         /**
          * Callback for receive GPS Data. If receive Data call 
          * @see updateGPSData for precessing.
          */
         void (*cb_receiveGPS)();
 
+        /**
+         * Send the SMS buffer. If it fails and the number is in store, the
+         * message is add to the queue for a retry.
+         *
+         * @param alarm             TRUE for alarm priority
+         * @return                  TRUE if message send
+         */
+        bool sendSMS(bool alarm);
+
+        /**
+         * Send all messages from queue they are due.
+         */
+        void processQueue();
+
+        /**
+         * Create the SMS text again from a queue entry.
+         *
+         * @param kind              Kind of message @see m_smsKind
+         * @param payload           Option for kind
+         */
+        void createQueueSMS(uint8_t kind, uint8_t payload);
+
         /**
          * Send a SMS text to all Numbers they have notify ON.
          */
@@ -122,12 +278,12 @@ class GPSDog :
 
         /**
          * Send a status alarm SMS to all number in store with active
-         * notify state. It also set @see m_nextAlarmSMS.
+         * notify state. It also restart @see GPSDOG_TIMER_ALARM.
          */
         void sendAlarmSMS();
 
         /**
-         * Calc the next milli value for resend the alarm to all numbers.
+         * Start the timer for resend the alarm to all numbers.
          * @see sendAlarmSMS.
          */
         void calcNextAlarm();
@@ -155,10 +311,35 @@ class GPSDog :
          */
         void createModeStateSMS(uint8_t mode);
 
+        /**
+         * Create SMS text with awake and sleep time.
+         */
+        void createPowerSMS();
+
+        /**
+         * Create SMS text with a number from store.
+         *
+         * @param idx               Index of number in store
+         */
+        void createStoreSMS(uint8_t idx);
+
+        /**
+         * Create SMS text with the time until GPS position is fix.
+         */
+        void createGpsFixSMS();
+
+        /**
+         * Create SMS text with the newest track points. It write only so
+         * many points as fit into the SMS.
+         *
+         * @param count             Max count of points
+         */
+        void createTrackSMS(uint8_t count);
+
         /**
          * Parse ON/OFF from a incoming SMS to a boolean.
          *
-         * @param idx               @see getParseElementUpper.
+         * @param idx               @see getParseElement.
          */
         bool parseOnOff(uint8_t idx);
 
@@ -171,6 +352,23 @@ class GPSDog :
          */
         void textOnOff(char *buffer, uint8_t size, bool onOff);
 
+        /**
+         * Search the parsed command in @see s_commands.
+         *
+         * @return                  Pointer to PROGMEM entry or NULL
+         */
+        const GD_COMMAND* findCommand();
+
+        /**
+         * Parse incoming SMS for a info text. Options are:
+         * - GPSDOG_OPT_SMS_STATUS
+         * - GPSDOG_OPT_SMS_POWER
+         * - All options of @see createDefaultSMS
+         *
+         * @param opt               See list above.
+         */
+        void readInfoFromSMS(uint8_t opt);
+
         /**
          * Parse incoming SMS for mode set/read functionality.
          *
@@ -180,23 +378,52 @@ class GPSDog :
 
         /**
          * Parse incoming SMS for initial functionality.
+         *
+         * @param opt               Option from command table (unused)
          */
-        void readInitFromSMS();
+        void readInitFromSMS(uint8_t opt);
 
         /**
          * Parse incoming SMS for reset functionality.
+         *
+         * @param opt               Option from command table (unused)
          */
-        void readResetFromSMS();
+        void readResetFromSMS(uint8_t opt);
 
         /**
          * Parse incoming SMS for store functionality.
+         *
+         * @param opt               Option from command table (unused)
          */
-        void readStoreFromSMS();
+        void readStoreFromSMS(uint8_t opt);
 
         /**
          * Parse incoming SMS for set interval/forward functionality.
+         *
+         * @param opt               Option from command table (unused)
          */
-        void readSetFromSMS();
+        void readSetFromSMS(uint8_t opt);
+
+        /**
+         * Parse incoming SMS for geofence zones.
+         *
+         * @param opt               Option from command table (unused)
+         */
+        void readZoneFromSMS(uint8_t opt);
+
+        /**
+         * Parse incoming SMS for the track.
+         *
+         * @param opt               Option from command table (unused)
+         */
+        void readTrackFromSMS(uint8_t opt);
+
+        /**
+         * Parse incoming SMS for stop alarm and watch.
+         *
+         * @param opt               Option from command table (unused)
+         */
+        void readStopFromSMS(uint8_t opt);
 
         /**
          * Set the System to Watching Mode.
@@ -206,29 +433,129 @@ class GPSDog :
          */
         void doWatching();
 
+        /**
+         * Check is a position out of watch radius and all zones.
+         *
+         * @param latitude          Latitude in microdegrees
+         * @param longitude         Longitude in microdegrees
+         * @return                  TRUE if it is outside
+         */
+        bool isOutsideWatch(int32_t latitude, int32_t longitude);
+
+        /**
+         * Position is fix. Start a waiting watch mode.
+         */
+        void setGpsFix();
+
+        /**
+         * Calc the period for GPS timer. It is short if the device is
+         * moving, in ALARM mode or the position is not fix. Else it
+         * double the period until GPSDOG_WAIT_GPS_MAX.
+         *
+         * @param moved             Position is moved since last sample
+         */
+        void calcGPSPeriod(bool moved);
+
+        /**
+         * Read the snapshot after boot and continue the alarm schedule.
+         */
+        void restoreSnapshot();
+
+        /**
+         * Write the runtime snapshot. It write not more as every
+         * GPSDOG_WAIT_SNAP_MIN and only if the state is changed. The
+         * track of a alarm is written not more as every
+         * GPSDOG_WAIT_TRACK_MIN and only if it is changed.
+         *
+         * @param force             Write also if position is the same
+         */
+        void saveSnapshot(bool force);
+
     public:
 
         GPSDog();
         
         /**
          * Initialize the Dog with all external data they needed to work.
+         * The config is read from EEPROM here, @see getConfigStatus.
          *
          * @param smsNum                Pointer to SMS buffer for number
          * @param smsNumSize            Size of SMS number buffer
          * @param smsTxt                Pointer to SMS buffer for message
          * @param smsTxtSize            Size of SMS message buffer
-         * @param cbSendSMS             Callback function for send SMS
+         * @param cbSendSMS             Callback function for send SMS, return TRUE if send
          * @param cbCheckSMS            Callback function for check new SMS
-         * @param cbRelaodSMS           Callback function for reload SMS
          * @param cbReceiveGPS          Callback function for update GPS pos
          */
-        void initialize(char *smsNum, uint8_t smsNumSize, char *smsTxt, uint8_t smsTxtSize, void (*cbSendSMS)(), void (*cbCheckSMS)(), void (*cbReladSMS)(), void (*cbReceiveGPS)());
+        void initialize(char *smsNum, uint8_t smsNumSize, char *smsTxt, uint8_t smsTxtSize, bool (*cbSendSMS)(), void (*cbCheckSMS)(), void (*cbReceiveGPS)());
 
         /**
-         * Main program loop.
+         * Main program loop. It call @see tick and wait until the next
+         * deadline. This function never returns.
          */
         void mainProcessing();
 
+        /**
+         * Enable or disable low power idle. If it is on, the MCU sleep
+         * in @see mainProcessing until the next deadline. In power-down
+         * only a level or pin change interrupt can wake up the MCU.
+         *
+         * @param onOff             TRUE for on and FALSE for off
+         */
+        void setIdleMode(bool onOff) {
+            m_idleMode = onOff;
+        }
+
+        /**
+         * Run all GPSDog work they is due at this time and return.
+         *
+         * @param now               Actual millis value
+         * @return                  Millis value of next deadline
+         */
+        uint32_t tick(uint32_t now);
+
+        /**
+         * Set the callback for sending one SMS text to many numbers. With
+         * this, the modem need only one check for a alarm.
+         *
+         * @param cbBroadcastSMS        Callback function for broadcast SMS
+         */
+        void setBroadcastCallback(void (*cbBroadcastSMS)(uint8_t count)) {
+            cb_broadcastSMS = cbBroadcastSMS;
+        }
+
+        /**
+         * Load a number of the running broadcast to SMS number buffer.
+         * The SMS text buffer is the same for all.
+         *
+         * @param idx                   Index of recipient < count
+         * @return                      FALSE if number is not available
+         */
+        bool loadBroadcastNumber(uint8_t idx);
+
+        /**
+         * Report the state of a send from the running broadcast. All
+         * recipients without a report are failed.
+         *
+         * @param idx                   Index of recipient < count
+         * @param send                  TRUE if SMS is send
+         */
+        void setBroadcastResult(uint8_t idx, bool send);
+
+        /**
+         * Enable the new SMS signal. After that, the SMS check is only
+         * a slow fallback and the work is done on @see signalNewSMS.
+         */
+        void enableSMSSignal();
+
+        /**
+         * Signal that a new SMS is arrived. It is safe to call it from a
+         * ISR like the modem ring indicator.
+         */
+        void signalNewSMS() {
+            m_newSMS = true;
+        }
+
         /**
          * Call this function for a new SMS in SMS buffer avilable for
          * processing.
@@ -236,10 +563,74 @@ class GPSDog :
         void processIncomingSMS();
 
         /**
-         * Call this function for update the device location.
+         * Get the count of SMS they drop from unknown numbers in protect
+         * mode without parsing.
+         */
+        uint16_t getDroppedSMS() {
+            return m_droppedSMS;
+        }
+
+        /**
+         * Status of the config read in @see initialize:
+         * - GPSDOG_CONF_LOAD_OK
+         * - GPSDOG_CONF_LOAD_FRESH (nothing found, default config)
+         * - GPSDOG_CONF_LOAD_MIGRATED (from old config version)
+         * - GPSDOG_CONF_LOAD_RECOVERED (a broken journal page is skipped)
+         */
+        uint8_t getConfigStatus() {
+            return this->loadConfig();
+        }
+
+        /**
+         * Count of bytes they are written to EEPROM since boot. Only changed
+         * config fields are written, so it is a way to check the wear.
+         */
+        uint32_t getEEPROMWrites() {
+            return GDConfig::getEEPROMWrites();
+        }
+
+        /**
+         * Call this function for update the device location. A fix with
+         * a impossible jump is ignored, see @see GDFilter.
+         *
+         * @param latitude              Latitude in microdegrees
+         * @param longitude             Longitude in microdegrees
+         * @param speed                 Speed in 1/100
+         * @param date                  Date in format YYYY-MM-DD
+         * @param time                  Time in format HH:MM
+         */
+        void updateGPSData(int32_t latitude, int32_t longitude, uint16_t speed, char *date, char *time);
+
+        /**
+         * Call this function for update the device location with the
+         * quality of the fix. The position is fix after
+         * GPSDOG_GPS_QUALITY_SAMPLES good fixes in a row, the timeout
+         * GPSDOG_WAIT_GPSFIX is only the fallback.
+         *
+         * @param latitude              Latitude in microdegrees
+         * @param longitude             Longitude in microdegrees
+         * @param speed                 Speed in 1/100
+         * @param fixType               GPSDOG_GPS_FIX_* type
+         * @param sats                  Count of used satellites
+         * @param hdop                  HDOP in 1/100
+         * @param date                  Date in format YYYY-MM-DD
+         * @param time                  Time in format HH:MM
+         */
+        void updateGPSData(int32_t latitude, int32_t longitude, uint16_t speed, uint8_t fixType, uint8_t sats, uint16_t hdop, char *date, char *time);
+
+        /**
+         * Call this function for update the device location. It convert
+         * the values for @see updateGPSData with integer.
          */
         void updateGPSData(double latitude, double longitude, double speed, char *date, char *time);
 
+        /**
+         * Call this function for update the device location with the
+         * quality of the fix. It convert the values for @see updateGPSData
+         * with integer.
+         */
+        void updateGPSData(double latitude, double longitude, double speed, uint8_t fixType, uint8_t sats, uint16_t hdop, char *date, char *time);
+
 };
 
 #endif
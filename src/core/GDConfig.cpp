@@ -1,42 +1,438 @@
 
 #include "GDConfig.h"
 
+// a full record need to fit into one journal page
+static_assert(sizeof(GD_DATA) + GPSDOG_CONF_JOURNAL_RECORD + GPSDOG_CONF_JOURNAL_HEADER <= GPSDOG_CONF_JOURNAL_PAGE_SIZE, "GD_DATA is to big for a journal page");
+static_assert(GPSDOG_CONF_JOURNAL_START + GPSDOG_CONF_JOURNAL_PAGES * GPSDOG_CONF_JOURNAL_PAGE_SIZE <= GPSDOG_CONF_CONTACT_START, "Journal is to big for EEPROM");
+
+// migration write the new image on the second page, the old one is on the first
+static_assert(GPSDOG_CONF_ADDR_07 == GPSDOG_CONF_JOURNAL_START && sizeof(GD_DATA_07) <= GPSDOG_CONF_JOURNAL_PAGE_SIZE && GPSDOG_CONF_JOURNAL_PAGES > 1, "Config 0x07 overlap the migration page");
+
+// contacts
+static_assert(GPSDOG_CONF_CONTACT_START + GPSDOG_CONF_NUMBER_STORE * GPSDOG_CONF_CONTACT_SIZE <= E2END + 1, "Number store is to big for EEPROM");
+static_assert(GPSDOG_CONF_NUMBER_STORE < 0x80 && GPSDOG_CONF_NUM_SIZE < 32, "Number store is to big for index");
+
 GDConfig::GDConfig()
 {
-    this->readConfig();
+    m_eepromWrites  ^= m_eepromWrites;
+    m_transaction   = false;
+    m_loadStatus    = GPSDOG_CONF_LOAD_NONE;
+    m_stageIdx      = GPSDOG_CONF_CONTACT_NONE;
+    m_stageClean    = false;
+
+    // until loadConfig
+    memset(&m_data, 0x00, sizeof(GD_DATA));
+    memset(m_dirty, 0x00, sizeof(m_dirty));
+    memset(m_contactLen, 0x00, sizeof(m_contactLen));
+    m_contactLenMask ^= m_contactLenMask;
+}
+
+uint8_t GDConfig::loadConfig()
+{
+    if (m_loadStatus == GPSDOG_CONF_LOAD_NONE) {
+        m_loadStatus = this->readConfig();
+    }
+
+    return m_loadStatus;
+}
+
+uint8_t GDConfig::readConfig()
+{
+    GD_DATA_07  old;
+    uint8_t     status;
+
+    // all changes are lost
+    memset(m_dirty, 0x00, sizeof(m_dirty));
+    memset(m_contactLen, 0x00, sizeof(m_contactLen));
+
+    ////
+    // Journal
+    status = this->readJournal(reinterpret_cast<uint8_t*>(&m_data), sizeof(GD_DATA), GPSDOG_CONF_VERSION);
+
+    if (status != GPSDOG_CONF_LOAD_NONE) {
+        // migration of 0x07 is cut before the contacts are moved
+        if (this->readOldConfig(&old)) {
+            this->migrateContacts(&old);
+            status = GPSDOG_CONF_LOAD_MIGRATED;
+        }
+
+        this->indexContacts();
+        return status;
+    }
+
+    ////
+    // Old layout 0x07 without journal
+    if (this->readOldConfig(&old)) {
+        this->migrateConfig(&old);
+
+        // new image on the page after the old one, it is not overwritten
+        m_journalPage   = 0;
+        m_journalSeq    = 0;
+        this->newJournalPage();
+
+        // remove old image only if the new one can be read back
+        if (this->readJournal(reinterpret_cast<uint8_t*>(&m_shadow), sizeof(GD_DATA), GPSDOG_CONF_VERSION) == GPSDOG_CONF_LOAD_OK && memcmp(&m_shadow, &m_data, sizeof(GD_DATA)) == 0) {
+            this->migrateContacts(&old);
+        }
 
-    // prepare number array
-    for (uint8_t i = 0; i < GPSDOG_CONF_NUMBER_STORE; ) 
-    {
-        // calc adress in memory
-        m_numbers[i++] = m_data.m_number1 + i * (GPSDOG_CONF_NUM_SIZE + 1);
+        this->indexContacts();
+        return GPSDOG_CONF_LOAD_MIGRATED;
     }
+
+    // start on first page with next write
+    m_journalPage   = GPSDOG_CONF_JOURNAL_PAGES -1;
+    m_journalSeq    = 0xFFFF;
+    m_journalPos    = GPSDOG_CONF_JOURNAL_START + GPSDOG_CONF_JOURNAL_PAGES * GPSDOG_CONF_JOURNAL_PAGE_SIZE;
+
+    // reset config
+    this->cleanConfig();
+    this->markDirty(0, sizeof(GD_DATA));
+
+    return GPSDOG_CONF_LOAD_FRESH;
 }
 
-void GDConfig::readConfig()
+bool GDConfig::readOldConfig(GD_DATA_07 *old)
 {
-    uint8_t *p = reinterpret_cast<uint8_t*>(&m_data);
+    uint8_t *p = reinterpret_cast<uint8_t*>(old);
 
-    // read
-    for (uint8_t i = 0; i < sizeof(GD_DATA); )
-    {
-        *p++ = EEPROM.read(i++);
+    for (uint8_t i = 0; i < sizeof(GD_DATA_07); i++) {
+        p[i] = EEPROM.read(GPSDOG_CONF_ADDR_07 + i);
     }
 
-    // is vesion nok and reset config
-    if (m_data.m_version != GPSDOG_CONF_VERSION) {
-        this->cleanConfig();
+    return old->m_version == GPSDOG_CONF_VERSION_07;
+}
+
+void GDConfig::migrateContacts(GD_DATA_07 *old)
+{
+    for (uint8_t i = 0; i < GPSDOG_CONF_NUMBER_STORE; i++) {
+        if (i < 0x04 && old->m_numbers[i][0] != 0x00) {
+            old->m_numbers[i][GPSDOG_CONF_NUM_SIZE] = 0x00;
+            this->writeContact(i, (old->m_signNums[i] & GPSDOG_CONF_CONTACT_SIGN) | (old->m_alarmNumbers[i] ? GPSDOG_CONF_CONTACT_NOTIFY : 0x00), old->m_numbers[i]);
+        }
+        else {
+            this->writeContact(i, 0x00, NULL);
+        }
+    }
+
+    // migration is done
+    this->updateEEPROM(GPSDOG_CONF_ADDR_07, 0x00);
+}
+
+void GDConfig::migrateConfig(GD_DATA_07 *old)
+{
+    m_data.m_version        = GPSDOG_CONF_VERSION;
+    m_data.m_alarmInterval  = old->m_alarmInterval;
+    m_data.m_forwardIdx     = old->m_forwardIdx;
+    m_data.m_unit           = old->m_unit;
+    m_data.m_filterConfirm  = GPSDOG_FILTER_CONFIRM_DEF;
+    m_data.m_filterSpeed    = GPSDOG_FILTER_SPEED_DEF;
+    m_data.m_filterMedian   = GPSDOG_FILTER_MEDIAN_DEF;
+
+    ////
+    // Modes to mask
+    m_data.m_modes ^= m_data.m_modes;
+
+    if (old->m_isInit) {
+        m_data.m_modes |= GPSDOG_MODE_INIT;
+    }
+    if (old->m_isWatch) {
+        m_data.m_modes |= GPSDOG_MODE_WATCH;
+    }
+    if (old->m_isAlarm) {
+        m_data.m_modes |= GPSDOG_MODE_ALARM;
+    }
+    if (old->m_isProtect) {
+        m_data.m_modes |= GPSDOG_MODE_PROTECT;
+    }
+    if (old->m_isForward) {
+        m_data.m_modes |= GPSDOG_MODE_FORWARD;
+    }
+    if (old->m_doWatchOn) {
+        m_data.m_modes |= GPSDOG_MODE_DOWATCH;
+    }
+
+    memcpy(m_data.m_password, old->m_password, GPSDOG_CONF_PW_SIZE +1);
+
+    ////
+    // GPS Data
+    m_data.m_latitude   = lround(old->m_latitude * GPSDOG_GPS_GEO_SCALE);
+    m_data.m_longitude  = lround(old->m_longitude * GPSDOG_GPS_GEO_SCALE);
+    m_data.m_geoRadius  = GPSDOG_GPS_RADIUS_MAX;
+
+    // degrees to meters
+    if (old->m_geoFix * 111195.0 < GPSDOG_GPS_RADIUS_MAX) {
+        m_data.m_geoRadius = old->m_geoFix > 0.0 ? old->m_geoFix * 111195.0 + 1 : GPSDOG_GPS_RADIUS_DEF;
     }
 }
 
 void GDConfig::writeConfig()
 {
-    uint8_t *p = reinterpret_cast<uint8_t*>(&m_data);
+    uint8_t start   = sizeof(GD_DATA);
+    uint8_t end     = 0;
+
+    // write on commit
+    if (m_transaction) {
+        return;
+    }
 
-    // write
-    for (uint8_t i = 0; i < sizeof(GD_DATA); )
-    {
-        EEPROM.update(i++, *p++);
+    ////
+    // Range over all changed bytes
+    for (uint8_t i = 0; i < sizeof(GD_DATA); i++) {
+        if (this->isDirty(i)) {
+            start   = i < start ? i : start;
+            end     = i;
+        }
+    }
+
+    // nothing changed
+    if (start > end) {
+        return;
+    }
+
+    // one record (or a new page) is all or nothing on power loss
+    this->appendJournal(start, end - start +1);
+
+    memset(m_dirty, 0x00, sizeof(m_dirty));
+}
+
+void GDConfig::beginConfig()
+{
+    memcpy(&m_shadow, &m_data, sizeof(GD_DATA));
+    memcpy(m_shadowDirty, m_dirty, sizeof(m_dirty));
+
+    m_transaction = true;
+}
+
+void GDConfig::commitConfig()
+{
+    m_transaction = false;
+
+    // contacts first, a cut INIT can be send again
+    this->flushContacts();
+    this->writeConfig();
+}
+
+void GDConfig::abortConfig()
+{
+    if (!m_transaction) {
+        return;
+    }
+
+    memcpy(&m_data, &m_shadow, sizeof(GD_DATA));
+    memcpy(m_dirty, m_shadowDirty, sizeof(m_dirty));
+
+    // drop staged contacts / index from EEPROM
+    m_stageIdx      = GPSDOG_CONF_CONTACT_NONE;
+    m_stageClean    = false;
+    m_transaction   = false;
+
+    this->indexContacts();
+}
+
+void GDConfig::markDirty(uint8_t offset, uint8_t size)
+{
+    for (uint8_t i = offset; i < offset + size && i < sizeof(GD_DATA); i++) {
+        m_dirty[i >> 3] |= 1 << (i & 0x07);
+    }
+}
+
+void GDConfig::updateEEPROM(uint16_t addr, uint8_t val)
+{
+    if (EEPROM.read(addr) != val) {
+        EEPROM.write(addr, val);
+        m_eepromWrites++;
+    }
+}
+
+uint8_t GDConfig::crcEEPROM(uint16_t addr, uint16_t size, uint8_t crc)
+{
+    for (uint16_t i = 0; i < size; i++) {
+        crc = _crc8_ccitt_update(crc, EEPROM.read(addr + i));
+    }
+
+    return crc;
+}
+
+uint8_t GDConfig::readJournal(uint8_t *image, uint8_t size, uint8_t version)
+{
+    uint16_t    addr;
+    uint16_t    seq;
+    uint16_t    maxSeq  = 0;
+    uint8_t     page;
+    bool        found;
+    bool        broken  = false;
+
+    ////
+    // Try pages from newest to oldest
+    for (uint8_t tries = 0; tries < GPSDOG_CONF_JOURNAL_PAGES; tries++) {
+        found = false;
+        page  = 0;
+
+        // search newest page they is older as the last try
+        for (uint8_t i = 0; i < GPSDOG_CONF_JOURNAL_PAGES; i++) {
+            addr = GPSDOG_CONF_JOURNAL_START + i * GPSDOG_CONF_JOURNAL_PAGE_SIZE;
+
+            // check header
+            if (EEPROM.read(addr) != GPSDOG_CONF_JOURNAL_MAGIC) {
+                continue;
+            }
+            if (this->crcEEPROM(addr, GPSDOG_CONF_JOURNAL_HEADER -1, 0x00) != EEPROM.read(addr + GPSDOG_CONF_JOURNAL_HEADER -1)) {
+                broken = true;
+                continue;
+            }
+            if (EEPROM.read(addr + 3) != version) {
+                continue;
+            }
+
+            seq = EEPROM.read(addr + 1) | (EEPROM.read(addr + 2) << 8);
+
+            // older as last try
+            if (tries > 0 && static_cast<int16_t>(seq - maxSeq) >= 0) {
+                continue;
+            }
+
+            // newest
+            if (!found || static_cast<int16_t>(seq - m_journalSeq) > 0) {
+                found           = true;
+                page            = i;
+                m_journalSeq    = seq;
+            }
+        }
+
+        // no more pages
+        if (!found) {
+            return GPSDOG_CONF_LOAD_NONE;
+        }
+
+        // replay
+        if (this->replayJournalPage(page, m_journalSeq, image, size)) {
+            m_journalPage = page;
+            return broken || tries > 0 ? GPSDOG_CONF_LOAD_RECOVERED : GPSDOG_CONF_LOAD_OK;
+        }
+
+        maxSeq = m_journalSeq;
+    }
+
+    return GPSDOG_CONF_LOAD_NONE;
+}
+
+bool GDConfig::replayJournalPage(uint8_t page, uint16_t seq, uint8_t *image, uint8_t size)
+{
+    uint16_t    addr    = GPSDOG_CONF_JOURNAL_START + page * GPSDOG_CONF_JOURNAL_PAGE_SIZE + GPSDOG_CONF_JOURNAL_HEADER;
+    uint16_t    end     = GPSDOG_CONF_JOURNAL_START + (page + 1) * GPSDOG_CONF_JOURNAL_PAGE_SIZE;
+    uint8_t     offset;
+    uint8_t     count;
+    bool        base    = true;
+
+    ////
+    // Read all records
+    while (addr + GPSDOG_CONF_JOURNAL_RECORD <= end) {
+        offset  = EEPROM.read(addr + 1);
+        count   = EEPROM.read(addr + 2);
+
+        // tag & size
+        if (EEPROM.read(addr) != static_cast<uint8_t>(seq) || count == 0 || offset + count > size || addr + count + GPSDOG_CONF_JOURNAL_RECORD > end) {
+            break;
+        }
+
+        // first record need all data
+        if (base && (offset != 0 || count != size)) {
+            break;
+        }
+
+        // crc
+        if (this->crcEEPROM(addr, count + 3, static_cast<uint8_t>(seq >> 8)) != EEPROM.read(addr + count + 3)) {
+            break;
+        }
+
+        // copy data
+        for (uint8_t i = 0; i < count; i++) {
+            image[offset + i] = EEPROM.read(addr + 3 + i);
+        }
+
+        base    = false;
+        addr    += count + GPSDOG_CONF_JOURNAL_RECORD;
+    }
+
+    m_journalPos = addr;
+
+    return !base;
+}
+
+bool GDConfig::appendJournal(uint8_t offset, uint8_t size)
+{
+    uint16_t end = GPSDOG_CONF_JOURNAL_START + (m_journalPage + 1) * GPSDOG_CONF_JOURNAL_PAGE_SIZE;
+
+    // page is full
+    if (m_journalPos + size + GPSDOG_CONF_JOURNAL_RECORD > end) {
+        this->newJournalPage();
+        return true;
+    }
+
+    m_journalPos = this->writeJournalRecord(m_journalPos, offset, size);
+    return false;
+}
+
+uint16_t GDConfig::writeJournalRecord(uint16_t addr, uint8_t offset, uint8_t size)
+{
+    uint8_t *p  = reinterpret_cast<uint8_t*>(&m_data) + offset;
+    uint8_t crc = static_cast<uint8_t>(m_journalSeq >> 8);
+
+    // header
+    this->updateEEPROM(addr + 1, offset);
+    this->updateEEPROM(addr + 2, size);
+
+    crc = _crc8_ccitt_update(crc, static_cast<uint8_t>(m_journalSeq));
+    crc = _crc8_ccitt_update(crc, offset);
+    crc = _crc8_ccitt_update(crc, size);
+
+    // data
+    for (uint8_t i = 0; i < size; i++) {
+        this->updateEEPROM(addr + 3 + i, p[i]);
+        crc = _crc8_ccitt_update(crc, p[i]);
+    }
+
+    this->updateEEPROM(addr + 3 + size, crc);
+
+    // tag at last, a record without it is not valid
+    this->updateEEPROM(addr, static_cast<uint8_t>(m_journalSeq));
+
+    return addr + size + GPSDOG_CONF_JOURNAL_RECORD;
+}
+
+void GDConfig::newJournalPage()
+{
+    uint16_t    addr;
+    uint8_t     header[GPSDOG_CONF_JOURNAL_HEADER];
+    uint8_t     crc = 0x00;
+
+    // next page
+    m_journalPage   = (m_journalPage + 1) % GPSDOG_CONF_JOURNAL_PAGES;
+    m_journalSeq++;
+
+    addr = GPSDOG_CONF_JOURNAL_START + m_journalPage * GPSDOG_CONF_JOURNAL_PAGE_SIZE;
+
+    // invalidate old header
+    this->updateEEPROM(addr, 0x00);
+
+    // base record with all data
+    m_journalPos = this->writeJournalRecord(addr + GPSDOG_CONF_JOURNAL_HEADER, 0, sizeof(GD_DATA));
+
+    ////
+    // Commit page with header
+    header[0] = GPSDOG_CONF_JOURNAL_MAGIC;
+    header[1] = static_cast<uint8_t>(m_journalSeq);
+    header[2] = static_cast<uint8_t>(m_journalSeq >> 8);
+    header[3] = GPSDOG_CONF_VERSION;
+
+    for (uint8_t i = 0; i < GPSDOG_CONF_JOURNAL_HEADER -1; i++) {
+        crc = _crc8_ccitt_update(crc, header[i]);
+    }
+    header[GPSDOG_CONF_JOURNAL_HEADER -1] = crc;
+
+    // write magic at last
+    for (uint8_t i = GPSDOG_CONF_JOURNAL_HEADER; i > 0; i--) {
+        this->updateEEPROM(addr + i -1, header[i -1]);
     }
 }
 
@@ -46,27 +442,14 @@ void GDConfig::cleanConfig()
     m_data.m_version        = GPSDOG_CONF_VERSION;
     m_data.m_alarmInterval  = GPSDOG_CONF_ALARM_INTERVAL;
 
-    // state
-    m_data.m_isInit         = false;
-    m_data.m_isWatch        = false;
-    m_data.m_isAlarm        = false;
-    m_data.m_isProtect      = false;
-    m_data.m_isForward      = false;
-
-    // do states
-    m_data.m_doWatchOn      = false;
+    // state & do states
+    m_data.m_modes          ^= m_data.m_modes;
 
     // options
     m_data.m_forwardIdx     ^= m_data.m_forwardIdx;
 
-    // alarm
-    memset(m_data.m_alarmNumbers, 0x00, GPSDOG_CONF_NUMBER_STORE);
-
-    // sign
-    memset(m_data.m_signNums, 0x00, GPSDOG_CONF_NUMBER_STORE);
-
     // phone store
-    memset(m_data.m_number1, 0x00, (GPSDOG_CONF_NUM_SIZE +1) * GPSDOG_CONF_NUMBER_STORE);
+    this->cleanContacts();
 
     // pw
     memset(m_data.m_password, 0x00, GPSDOG_CONF_PW_SIZE +1);
@@ -74,77 +457,295 @@ void GDConfig::cleanConfig()
     // GPS Data
     m_data.m_latitude   = 0;
     m_data.m_longitude  = 0;
-    m_data.m_geoFix     = 0.0005;
+    m_data.m_geoRadius  = GPSDOG_GPS_RADIUS_DEF;
 
     // UNIT
     m_data.m_unit       = GPSDOG_UNIT_KMH;
+
+    // Filter
+    m_data.m_filterConfirm  = GPSDOG_FILTER_CONFIRM_DEF;
+    m_data.m_filterSpeed    = GPSDOG_FILTER_SPEED_DEF;
+    m_data.m_filterMedian   = GPSDOG_FILTER_MEDIAN_DEF;
+
+    this->markDirty(0, sizeof(GD_DATA));
 }
 
-bool GDConfig::setStoreNumber(uint8_t numStoreIdx, char *num, uint8_t sign)
+uint16_t GDConfig::hashNumber(const char *num, uint8_t len)
 {
-    // index secure & sign not lager than num
-    if (strlen(num) > GPSDOG_CONF_NUM_SIZE || numStoreIdx >= GPSDOG_CONF_NUMBER_STORE || numStoreIdx < 0 || strlen(num) <= sign) {
-        return false;
+    uint16_t hash = 0xFFFF;
+
+    for (uint8_t i = 0; i < len; i++) {
+        hash = _crc16_update(hash, num[i]);
+    }
+
+    return hash;
+}
+
+bool GDConfig::readContact(uint8_t numStoreIdx)
+{
+    uint16_t    addr    = GPSDOG_CONF_CONTACT_START + numStoreIdx * GPSDOG_CONF_CONTACT_SIZE;
+    uint8_t     flags   = this->readContactFlags(numStoreIdx);
+
+    ////
+    // Staged in transaction
+    if (numStoreIdx == m_stageIdx) {
+        memcpy(m_contact, m_stageNumber, GPSDOG_CONF_NUM_SIZE +1);
+    }
+    else if (m_stageClean) {
+        m_contact[0] = 0x00;
     }
+    ////
+    // EEPROM
+    else {
+        for (uint8_t i = 0; i < GPSDOG_CONF_NUM_SIZE; i++) {
+            m_contact[i] = EEPROM.read(addr + 1 + i);
+        }
+        m_contact[GPSDOG_CONF_NUM_SIZE] = 0x00;
 
-    // clear & copy
-    memset(m_numbers[numStoreIdx], 0x00, GPSDOG_CONF_NUM_SIZE +1);
-    strncpy(m_numbers[numStoreIdx], num, GPSDOG_CONF_NUM_SIZE);
+        // broken
+        if (this->crcEEPROM(addr, GPSDOG_CONF_CONTACT_SIZE -1, 0x00) != EEPROM.read(addr + GPSDOG_CONF_CONTACT_SIZE -1)) {
+            m_contact[0] = 0x00;
+        }
+    }
 
-    m_data.m_signNums[numStoreIdx] = sign;
+    // empty
+    if (strlen(m_contact) <= (flags & GPSDOG_CONF_CONTACT_SIGN)) {
+        m_contact[0] = 0x00;
+        return false;
+    }
 
     return true;
 }
 
-bool GDConfig::checkStoreNumber(uint8_t numStoreIdx, char *num)
+uint8_t GDConfig::readContactFlags(uint8_t numStoreIdx)
 {
-    // index secure
-    if (numStoreIdx >= GPSDOG_CONF_NUMBER_STORE || numStoreIdx < 0 || num == NULL) {
-        return false;
+    // staged in transaction
+    if (numStoreIdx == m_stageIdx) {
+        return m_stageFlags;
+    }
+    else if (m_stageClean) {
+        return 0x00;
     }
 
-    // check if NULL
-    if (m_numbers[numStoreIdx][m_data.m_signNums[numStoreIdx]] == 0x00 || num[0] == 0x00) {
-        return false;
+    return EEPROM.read(GPSDOG_CONF_CONTACT_START + numStoreIdx * GPSDOG_CONF_CONTACT_SIZE);
+}
+
+void GDConfig::writeContact(uint8_t numStoreIdx, uint8_t flags, const char *num)
+{
+    uint8_t len = 0;
+
+    // delete
+    if (num == NULL) {
+        flags = 0x00;
+    }
+    else {
+        len = strlen(num);
     }
 
-    // check number
-    if (strstr(num, m_numbers[numStoreIdx] + m_data.m_signNums[numStoreIdx]) != NULL) {
-        return true;
+    ////
+    // Stage until commit, only one contact
+    if (m_transaction) {
+        if (m_stageIdx != GPSDOG_CONF_CONTACT_NONE && m_stageIdx != numStoreIdx) {
+            this->flushContacts();
+        }
+
+        m_stageIdx      = numStoreIdx;
+        m_stageFlags    = flags;
+
+        memset(m_stageNumber, 0x00, GPSDOG_CONF_NUM_SIZE +1);
+
+        if (num != NULL) {
+            memcpy(m_stageNumber, num, len);
+        }
+    }
+    else {
+        this->storeContact(numStoreIdx, flags, num);
     }
 
-    return false;
+    ////
+    // Update index
+    if (len == 0) {
+        m_contactLen[numStoreIdx] = 0;
+    }
+    else {
+        m_contactLen[numStoreIdx]   = len - (flags & GPSDOG_CONF_CONTACT_SIGN);
+        m_contactHash[numStoreIdx]  = hashNumber(num + (flags & GPSDOG_CONF_CONTACT_SIGN), m_contactLen[numStoreIdx]);
+    }
+
+    m_contactLenMask ^= m_contactLenMask;
+
+    for (uint8_t i = 0; i < GPSDOG_CONF_NUMBER_STORE; i++) {
+        if (m_contactLen[i] > 0) {
+            m_contactLenMask |= 1UL << m_contactLen[i];
+        }
+    }
 }
 
-bool GDConfig::foundNumberInStore(char *num)
+void GDConfig::storeContact(uint8_t numStoreIdx, uint8_t flags, const char *num)
+{
+    uint16_t    addr    = GPSDOG_CONF_CONTACT_START + numStoreIdx * GPSDOG_CONF_CONTACT_SIZE;
+    uint8_t     crc     = 0x00;
+    uint8_t     len     = num != NULL ? strlen(num) : 0;
+    uint8_t     val;
+
+    this->updateEEPROM(addr, flags);
+    crc = _crc8_ccitt_update(crc, flags);
+
+    // number with 0x00 padding
+    for (uint8_t i = 0; i < GPSDOG_CONF_NUM_SIZE; i++) {
+        val = i < len ? num[i] : 0x00;
+
+        this->updateEEPROM(addr + 1 + i, val);
+        crc = _crc8_ccitt_update(crc, val);
+    }
+
+    this->updateEEPROM(addr + GPSDOG_CONF_CONTACT_SIZE -1, crc);
+}
+
+void GDConfig::cleanContacts()
 {
-    // search in store numbers 
+    // stage until commit
+    if (m_transaction) {
+        m_stageIdx      = GPSDOG_CONF_CONTACT_NONE;
+        m_stageClean    = true;
+
+        memset(m_contactLen, 0x00, sizeof(m_contactLen));
+        m_contactLenMask ^= m_contactLenMask;
+        return;
+    }
+
     for (uint8_t i = 0; i < GPSDOG_CONF_NUMBER_STORE; i++) {
+        this->writeContact(i, 0x00, NULL);
+    }
+}
 
-        // compare number
-        if (this->checkStoreNumber(i, num)) {
-            return true;
+void GDConfig::flushContacts()
+{
+    // delete all other
+    if (m_stageClean) {
+        for (uint8_t i = 0; i < GPSDOG_CONF_NUMBER_STORE; i++) {
+            if (i != m_stageIdx) {
+                this->storeContact(i, 0x00, NULL);
+            }
         }
     }
 
-    // not found
-    return false;
+    if (m_stageIdx != GPSDOG_CONF_CONTACT_NONE) {
+        this->storeContact(m_stageIdx, m_stageFlags, m_stageNumber);
+    }
+
+    m_stageIdx      = GPSDOG_CONF_CONTACT_NONE;
+    m_stageClean    = false;
 }
 
-bool GDConfig::addNumberWithNotify(uint8_t numStoreIdx, char *num, uint8_t sign, bool notify)
+void GDConfig::indexContacts()
 {
-    // index secure
-    if (numStoreIdx >= GPSDOG_CONF_NUMBER_STORE || numStoreIdx < 0) {
+    uint8_t sign;
+
+    m_contactLenMask ^= m_contactLenMask;
+
+    for (uint8_t i = 0; i < GPSDOG_CONF_NUMBER_STORE; i++) {
+        // empty
+        if (!this->readContact(i)) {
+            m_contactLen[i] = 0;
+            continue;
+        }
+
+        sign = this->readContactFlags(i) & GPSDOG_CONF_CONTACT_SIGN;
+
+        m_contactLen[i]     = strlen(m_contact) - sign;
+        m_contactHash[i]    = hashNumber(m_contact + sign, m_contactLen[i]);
+        m_contactLenMask    |= 1UL << m_contactLen[i];
+    }
+}
+
+bool GDConfig::setStoreNumber(uint8_t numStoreIdx, char *num, uint8_t sign)
+{
+    // index secure & sign not lager than num
+    if (strlen(num) > GPSDOG_CONF_NUM_SIZE || numStoreIdx >= GPSDOG_CONF_NUMBER_STORE || strlen(num) <= sign) {
         return false;
     }
 
-    // set number to store
-    if (!this->setStoreNumber(numStoreIdx, num, sign)) {
+    // keep notify
+    this->writeContact(numStoreIdx, sign | (this->isAlarmNotifyOn(numStoreIdx) ? GPSDOG_CONF_CONTACT_NOTIFY : 0x00), num);
+
+    return true;
+}
+
+void GDConfig::delStoreNumber(uint8_t numStoreIdx)
+{
+    // index secure
+    if (numStoreIdx >= GPSDOG_CONF_NUMBER_STORE) {
+        return;
+    }
+
+    this->writeContact(numStoreIdx, 0x00, NULL);
+}
+
+char* GDConfig::getStoreNumber(uint8_t numStoreIdx)
+{
+    m_contact[0] = 0x00;
+
+    // index secure
+    if (numStoreIdx < GPSDOG_CONF_NUMBER_STORE && m_contactLen[numStoreIdx] > 0) {
+        this->readContact(numStoreIdx);
+    }
+
+    return m_contact;
+}
+
+uint8_t GDConfig::getNumberIdxInStore(char *num)
+{
+    uint8_t     size;
+    uint16_t    hash;
+
+    if (num == NULL) {
+        return GPSDOG_CONF_NUMBER_STORE;
+    }
+
+    size = strlen(num);
+
+    ////
+    // Every used count of significant digits
+    for (uint8_t len = 1; len <= size && len <= GPSDOG_CONF_NUM_SIZE; len++) {
+
+        if ((m_contactLenMask & (1UL << len)) == 0) {
+            continue;
+        }
+
+        hash = hashNumber(num + size - len, len);
+
+        // search in index / confirm on EEPROM
+        for (uint8_t i = 0; i < GPSDOG_CONF_NUMBER_STORE; i++) {
+            if (m_contactLen[i] != len || m_contactHash[i] != hash) {
+                continue;
+            }
+
+            this->readContact(i);
+
+            if (strcmp(m_contact + strlen(m_contact) - len, num + size - len) == 0) {
+                return i;
+            }
+        }
+    }
+
+    // not found
+    return GPSDOG_CONF_NUMBER_STORE;
+}
+
+bool GDConfig::foundNumberInStore(char *num)
+{
+    return this->getNumberIdxInStore(num) < GPSDOG_CONF_NUMBER_STORE;
+}
+
+bool GDConfig::addNumberWithNotify(uint8_t numStoreIdx, char *num, uint8_t sign, bool notify)
+{
+    // index secure & sign not lager than num
+    if (strlen(num) > GPSDOG_CONF_NUM_SIZE || numStoreIdx >= GPSDOG_CONF_NUMBER_STORE || strlen(num) <= sign) {
         return false;
     }
 
-    // set Notify flag
-    this->setAlarmNotify(numStoreIdx, notify);
+    this->writeContact(numStoreIdx, sign | (notify ? GPSDOG_CONF_CONTACT_NOTIFY : 0x00), num);
 
     return true;
 }
@@ -152,38 +753,36 @@ bool GDConfig::addNumberWithNotify(uint8_t numStoreIdx, char *num, uint8_t sign,
 uint8_t GDConfig::getSignNumber(uint8_t numStoreIdx)
 {
     // index secure
-    if (numStoreIdx >= GPSDOG_CONF_NUMBER_STORE || numStoreIdx < 0) {
-        return false;
+    if (numStoreIdx >= GPSDOG_CONF_NUMBER_STORE || m_contactLen[numStoreIdx] == 0) {
+        return 0x00;
     }
 
-    return m_data.m_signNums[numStoreIdx];
+    return this->readContactFlags(numStoreIdx) & GPSDOG_CONF_CONTACT_SIGN;
 }
 
 bool GDConfig::isAlarmNotifyOn(uint8_t numStoreIdx)
 {
     // index secure
-    if (numStoreIdx >= GPSDOG_CONF_NUMBER_STORE || numStoreIdx < 0) {
+    if (numStoreIdx >= GPSDOG_CONF_NUMBER_STORE || m_contactLen[numStoreIdx] == 0) {
         return false;
     }
 
-    return m_data.m_alarmNumbers[numStoreIdx];
+    return (this->readContactFlags(numStoreIdx) & GPSDOG_CONF_CONTACT_NOTIFY) != 0x00;
 }
 
 void GDConfig::setAlarmNotify(uint8_t numStoreIdx, bool onOff)
 {
-    // index secure
-    if (numStoreIdx >= GPSDOG_CONF_NUMBER_STORE || numStoreIdx < 0) {
+    uint8_t sign;
+
+    // index secure / no number
+    if (numStoreIdx >= GPSDOG_CONF_NUMBER_STORE || m_contactLen[numStoreIdx] == 0) {
         return;
     }
 
-    if (onOff) {
-        // ON
-        m_data.m_alarmNumbers[numStoreIdx] = true;
-    }
-    else {
-        // OFF
-        m_data.m_alarmNumbers[numStoreIdx] = false; 
-    }
+    sign = this->getSignNumber(numStoreIdx);
+    this->readContact(numStoreIdx);
+
+    this->writeContact(numStoreIdx, sign | (onOff ? GPSDOG_CONF_CONTACT_NOTIFY : 0x00), m_contact);
 }
 
 bool GDConfig::setPasswordInit(char *pw)
@@ -195,6 +794,8 @@ bool GDConfig::setPasswordInit(char *pw)
 
     // copy data / set init flag
     strncpy(m_data.m_password, pw, GPSDOG_CONF_PW_SIZE);
+    GPSDOG_CONF_DIRTY(m_password);
+
     this->setMode(GPSDOG_MODE_INIT, true);
 
     return true;
@@ -209,50 +810,16 @@ bool GDConfig::checkPassword(char *pw)
     return false;
 }
 
-bool GDConfig::isModeOn(uint8_t mode)
-{
-    switch (mode)
-    {
-        // State
-        case GPSDOG_MODE_INIT       : return m_data.m_isInit;
-        case GPSDOG_MODE_WATCH      : return m_data.m_isWatch;
-        case GPSDOG_MODE_ALARM      : return m_data.m_isAlarm;
-        case GPSDOG_MODE_PROTECT    : return m_data.m_isProtect;
-        case GPSDOG_MODE_FORWARD    : return m_data.m_isForward;
-
-        // Do state
-        case GPSDOG_MODE_DOWATCH    : return m_data.m_doWatchOn;
-    }
-
-    return false;
-}
-
 void GDConfig::setMode(uint8_t mode, bool onOff)
 {
-    switch (mode)
-    {
-        // State
-        case GPSDOG_MODE_INIT       : 
-            m_data.m_isInit = onOff;
-            return;
-        case GPSDOG_MODE_WATCH      : 
-            m_data.m_isWatch = onOff;
-            return;
-        case GPSDOG_MODE_ALARM      : 
-            m_data.m_isAlarm = onOff;
-            return;
-        case GPSDOG_MODE_PROTECT    : 
-            m_data.m_isProtect = onOff;
-            return;
-        case GPSDOG_MODE_FORWARD    : 
-            m_data.m_isForward = onOff;
-            return;
-
-        // Do state
-        case GPSDOG_MODE_DOWATCH    : 
-            m_data.m_doWatchOn = onOff;
-            return;
+    if (onOff) {
+        m_data.m_modes |= mode;
+    }
+    else {
+        m_data.m_modes &= ~mode;
     }
+
+    GPSDOG_CONF_DIRTY(m_modes);
 }
 
 void GDConfig::setForwardIdx(uint8_t val)
@@ -263,6 +830,7 @@ void GDConfig::setForwardIdx(uint8_t val)
     }
 
     m_data.m_forwardIdx = val;
+    GPSDOG_CONF_DIRTY(m_forwardIdx);
 }
 
 // vim: set sts=4 sw=4 ts=4 et:
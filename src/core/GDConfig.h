@@ -6,8 +6,12 @@
 #include <EEPROM.h>
 #include <inttypes.h>
 #include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include <util/crc16.h>
 
 #include "GDGps.h"
+#include "GDFilter.h"
 
 // Buffer Size
 // String buffer +1
@@ -15,23 +19,64 @@
 #define GPSDOG_CONF_NUM_SIZE 20
 
 // config
-#define GPSDOG_CONF_NUMBER_STORE 0x04
+#ifndef GPSDOG_CONF_NUMBER_STORE
+#define GPSDOG_CONF_NUMBER_STORE 16
+#endif
 #define GPSDOG_CONF_ALARM_INTERVAL  15 // Min
+#define GPSDOG_CONF_ALARM_INTERVAL_MAX 0xFF // Min
 
-// mode
+// mode (bit in mode mask)
 #define GPSDOG_MODE_INIT 0x01
 #define GPSDOG_MODE_WATCH 0x02
-#define GPSDOG_MODE_ALARM 0x03
-#define GPSDOG_MODE_PROTECT 0x04
-#define GPSDOG_MODE_FORWARD 0x05
-#define GPSDOG_MODE_DOWATCH 0x06
+#define GPSDOG_MODE_ALARM 0x04
+#define GPSDOG_MODE_PROTECT 0x08
+#define GPSDOG_MODE_FORWARD 0x10
+#define GPSDOG_MODE_DOWATCH 0x20
 
 // unit
 #define GPSDOG_UNIT_KMH 0x01
 #define GPSDOG_UNIT_MPH 0x02
 
 // Config Version
-#define GPSDOG_CONF_VERSION 0x07
+#define GPSDOG_CONF_VERSION 0x0A
+#define GPSDOG_CONF_VERSION_07 0x07
+
+// EEPROM address of config 0x07 (before journal)
+#define GPSDOG_CONF_ADDR_07 0x0000
+
+// config load status
+#define GPSDOG_CONF_LOAD_NONE 0x00
+#define GPSDOG_CONF_LOAD_OK 0x01
+#define GPSDOG_CONF_LOAD_FRESH 0x02
+#define GPSDOG_CONF_LOAD_MIGRATED 0x03
+#define GPSDOG_CONF_LOAD_RECOVERED 0x04
+
+// EEPROM journal
+#define GPSDOG_CONF_JOURNAL_START 0x0000
+#define GPSDOG_CONF_JOURNAL_PAGES 0x02
+#define GPSDOG_CONF_JOURNAL_PAGE_SIZE 0x0080
+#define GPSDOG_CONF_JOURNAL_MAGIC 0x47 // G
+
+// journal page header: magic, seq low, seq high, version, crc
+#define GPSDOG_CONF_JOURNAL_HEADER 0x05
+
+// journal record: tag, offset, size, data..., crc
+#define GPSDOG_CONF_JOURNAL_RECORD 0x04
+
+// EEPROM contact store
+// contact: flags, number..., crc
+#define GPSDOG_CONF_CONTACT_START 0x0100
+#define GPSDOG_CONF_CONTACT_SIZE (GPSDOG_CONF_NUM_SIZE + 2)
+
+// contact flags: notify bit & sign
+#define GPSDOG_CONF_CONTACT_NOTIFY 0x80
+#define GPSDOG_CONF_CONTACT_SIGN 0x1F
+
+// no staged contact
+#define GPSDOG_CONF_CONTACT_NONE 0xFF
+
+// mark a field of GD_DATA as changed
+#define GPSDOG_CONF_DIRTY(field) this->markDirty(offsetof(GD_DATA, field), sizeof(m_data.field))
 
 /**
  *
@@ -41,23 +86,8 @@ struct GD_DATA
     /** Config struct version */
     uint8_t m_version;
 
-    /** GPSDog mode init, is system initualize with PW */
-    bool    m_isInit;
-
-    /** GPSDog mode watch, is system in watch state */
-    bool    m_isWatch;
-
-    /** GPSDog mode alarm, is system in alarm state */
-    bool    m_isAlarm;
-
-    /** GPSDog mode protect, is system in protect state */
-    bool    m_isProtect;
-
-    /** GPSDog mode forward, is system in forward state */
-    bool    m_isForward;
-
-    /** If you want set watch on if the GPS position is now fix */
-    bool    m_doWatchOn;
+    /** Mask of active GPSDOG_MODE_* states */
+    uint8_t m_modes;
 
     /** Password for branding */
     char    m_password[GPSDOG_CONF_PW_SIZE +1];
@@ -68,26 +98,48 @@ struct GD_DATA
     /** Number in store for sms forward to */
     uint8_t m_forwardIdx;
 
-    /** Holding notify information for number in store (Binary) */
-    bool    m_alarmNumbers[GPSDOG_CONF_NUMBER_STORE];
+    /** GPS Value in microdegrees */
+    int32_t m_latitude;
+    int32_t m_longitude;
 
-    /** Save sign count per phone number */
-    uint8_t m_signNums[GPSDOG_CONF_NUMBER_STORE];
+    /** Radius of watch geofence in meters */
+    uint16_t m_geoRadius;
 
-    /** Store for numbers they have full access to GPSDog */
-    char    m_number1[GPSDOG_CONF_NUM_SIZE +1];
-    char    m_number2[GPSDOG_CONF_NUM_SIZE +1];
-    char    m_number3[GPSDOG_CONF_NUM_SIZE +1];
-    char    m_number4[GPSDOG_CONF_NUM_SIZE +1];
+    /** KMH/MPH */
+    uint8_t m_unit;
 
-    /** GPS Value */
-    double  m_latitude;
-    double  m_longitude;
+    /** Count of outside fixes in a row for alarm */
+    uint8_t m_filterConfirm;
 
-    /** corrections for geo coordinat compaire */
-    double  m_geoFix;
+    /** Max. possible speed in km/h, 0 is off */
+    uint16_t m_filterSpeed;
 
-    /** KMH/MPH */
+    /** Window size of median filter, 1 is off */
+    uint8_t m_filterMedian;
+};
+
+/**
+ * Config layout of version 0x07. It is only used for migration. The
+ * coordinates was double, they is a 4 byte float on AVR.
+ */
+struct GD_DATA_07
+{
+    uint8_t m_version;
+    bool    m_isInit;
+    bool    m_isWatch;
+    bool    m_isAlarm;
+    bool    m_isProtect;
+    bool    m_isForward;
+    bool    m_doWatchOn;
+    char    m_password[GPSDOG_CONF_PW_SIZE +1];
+    uint8_t m_alarmInterval;
+    uint8_t m_forwardIdx;
+    bool    m_alarmNumbers[0x04];
+    uint8_t m_signNums[0x04];
+    char    m_numbers[0x04][GPSDOG_CONF_NUM_SIZE +1];
+    float   m_latitude;
+    float   m_longitude;
+    float   m_geoFix;
     uint8_t m_unit;
 };
 
@@ -99,33 +151,293 @@ class GDConfig
     private:
 
         /** Config data */
-        GD_DATA m_data;
+        GD_DATA     m_data;
+
+        /** Active journal page */
+        uint8_t     m_journalPage;
+
+        /** Sequence of active journal page */
+        uint16_t    m_journalSeq;
+
+        /** EEPROM address for the next journal record */
+        uint16_t    m_journalPos;
+
+        /** Bitmap of changed bytes in @see m_data */
+        uint8_t     m_dirty[(sizeof(GD_DATA) + 7) / 8];
+
+        /** Copy of config data on begin of a transaction */
+        GD_DATA     m_shadow;
+
+        /** Copy of @see m_dirty on begin of a transaction */
+        uint8_t     m_shadowDirty[(sizeof(GD_DATA) + 7) / 8];
+
+        /** Is a transaction open */
+        bool        m_transaction;
+
+        /** GPSDOG_CONF_LOAD_* of the config data */
+        uint8_t     m_loadStatus;
+
+        /** Count of bytes they are written to EEPROM */
+        uint32_t    m_eepromWrites;
+
+        /** Hash of the significant digits of every store number */
+        uint16_t    m_contactHash[GPSDOG_CONF_NUMBER_STORE];
+
+        /** Count of significant digits of every store number, 0 is empty */
+        uint8_t     m_contactLen[GPSDOG_CONF_NUMBER_STORE];
+
+        /** Bit per count of significant digits they are used in store */
+        uint32_t    m_contactLenMask;
+
+        /** Buffer for a number from store */
+        char        m_contact[GPSDOG_CONF_NUM_SIZE +1];
+
+        /** Contact they is changed in the transaction or _CONTACT_NONE */
+        uint8_t     m_stageIdx;
+
+        /** Flags of @see m_stageIdx */
+        uint8_t     m_stageFlags;
+
+        /** Number of @see m_stageIdx, empty for delete */
+        char        m_stageNumber[GPSDOG_CONF_NUM_SIZE +1];
+
+        /** Are all contacts deleted in the transaction */
+        bool        m_stageClean;
+
+        /**
+         * Mark a part of config data as changed.
+         *
+         * @param offset                Offset in config data
+         * @param size                  Count of bytes
+         */
+        void markDirty(uint8_t offset, uint8_t size);
+
+        /**
+         * Check is a byte of config data changed.
+         *
+         * @param offset                Offset in config data
+         * @return                      TRUE if it is changed
+         */
+        bool isDirty(uint8_t offset) {
+            return (m_dirty[offset >> 3] & (1 << (offset & 0x07))) != 0x00;
+        }
+
+        /**
+         * Write a byte to EEPROM if it is different and count it.
+         *
+         * @param addr                  EEPROM address
+         * @param val                   Value
+         */
+        void updateEEPROM(uint16_t addr, uint8_t val);
+
+        /**
+         * Calc CRC8 over EEPROM data.
+         *
+         * @param addr                  EEPROM address
+         * @param size                  Count of bytes
+         * @param crc                   Start value
+         * @return                      CRC8 value
+         */
+        uint8_t crcEEPROM(uint16_t addr, uint16_t size, uint8_t crc);
+
+        /**
+         * Read the newest valid journal page and replay all records into
+         * a image. On success the journal state is set to this page.
+         *
+         * @param image                 Buffer for config data
+         * @param size                  Size of config data
+         * @param version               Config version of the page
+         * @return                      GPSDOG_CONF_LOAD_OK, _RECOVERED if a
+         *                              broken page is skipped or _NONE
+         */
+        uint8_t readJournal(uint8_t *image, uint8_t size, uint8_t version);
+
+        /**
+         * Replay all records of a journal page into a image.
+         *
+         * @param page                  Journal page
+         * @param seq                   Sequence of journal page
+         * @param image                 Buffer for config data
+         * @param size                  Size of config data
+         * @return                      TRUE if the base record is valid
+         */
+        bool replayJournalPage(uint8_t page, uint16_t seq, uint8_t *image, uint8_t size);
+
+        /**
+         * Append a record with a part of config data to the journal. If
+         * the page is full, a new page with all data will be start.
+         *
+         * @param offset                Offset in config data
+         * @param size                  Count of bytes
+         * @return                      TRUE if a new page with all data
+         */
+        bool appendJournal(uint8_t offset, uint8_t size);
+
+        /**
+         * Write a record with a part of config data to EEPROM. The tag is
+         * written at last, so a cut record is not replayed.
+         *
+         * @param addr                  EEPROM address of record
+         * @param offset                Offset in config data
+         * @param size                  Count of bytes
+         * @return                      EEPROM address after the record
+         */
+        uint16_t writeJournalRecord(uint16_t addr, uint8_t offset, uint8_t size);
+
+        /**
+         * Start the next journal page with all config data.
+         */
+        void newJournalPage();
+
+        /**
+         * Read config data of version 0x07 from EEPROM.
+         *
+         * @param old                   Buffer for config data
+         * @return                      TRUE if it is a valid 0x07 image
+         */
+        bool readOldConfig(GD_DATA_07 *old);
+
+        /**
+         * Convert config data from version 0x07 to the actual layout. The
+         * numbers are moved later with @see migrateContacts.
+         *
+         * @param old                   Config data of version 0x07
+         */
+        void migrateConfig(GD_DATA_07 *old);
+
+        /**
+         * Move the numbers of version 0x07 to the contact store and
+         * invalidate the old image. It is call after the new config is
+         * written and read back, if power is lost before, the next read
+         * do it again.
+         *
+         * @param old                   Config data of version 0x07
+         */
+        void migrateContacts(GD_DATA_07 *old);
+
+        /**
+         * Calc the lookup hash over the end of a number.
+         *
+         * @param num                   Number
+         * @param len                   Count of digits from the end
+         * @return                      Hash value
+         */
+        static uint16_t hashNumber(const char *num, uint8_t len);
+
+        /**
+         * Read a contact number from EEPROM store to @see m_contact.
+         *
+         * @param numStoreIdx           Index of config store number.
+         * @return                      FALSE if contact is empty or broken
+         */
+        bool readContact(uint8_t numStoreIdx);
+
+        /**
+         * Read the flags of a contact, staged or from EEPROM store.
+         *
+         * @param numStoreIdx           Index of config store number.
+         * @return                      Notify bit & sign
+         */
+        uint8_t readContactFlags(uint8_t numStoreIdx);
+
+        /**
+         * Change a contact and update the lookup index. In a transaction
+         * it is staged until @see commitConfig, else it is written to
+         * EEPROM. Only one contact can be staged, a change of a other one
+         * write the staged contact before.
+         *
+         * @param numStoreIdx           Index of config store number.
+         * @param flags                 Notify bit & sign
+         * @param num                   Number or NULL for delete
+         */
+        void writeContact(uint8_t numStoreIdx, uint8_t flags, const char *num);
+
+        /**
+         * Write a contact to EEPROM store.
+         *
+         * @param numStoreIdx           Index of config store number.
+         * @param flags                 Notify bit & sign
+         * @param num                   Number or NULL for delete
+         */
+        void storeContact(uint8_t numStoreIdx, uint8_t flags, const char *num);
+
+        /**
+         * Delete all contacts, in a transaction it is staged.
+         */
+        void cleanContacts();
+
+        /**
+         * Write the staged contacts to EEPROM store.
+         */
+        void flushContacts();
+
+        /**
+         * Build the lookup index for all contacts from EEPROM store.
+         */
+        void indexContacts();
 
     public:
 
         /**
-         * Read Config data and reset it is the config version not correct.
+         * Config data is not read here, @see loadConfig.
          */
         GDConfig();
 
-        /** Array for easy access to number store from data struct */
-        char *m_numbers[GPSDOG_CONF_NUMBER_STORE];
-
         /**
          * Delete all config data and set it to default.
          */
         void cleanConfig();
 
         /**
-         * Read data form EEPROM.
+         * Read data form EEPROM journal. The old layout 0x07 on address 0
+         * will be migrate to the second journal page, the old image is
+         * only removed after this. Else it reset the config.
+         *
+         * @return                      GPSDOG_CONF_LOAD_* status
+         */
+        uint8_t readConfig();
+
+        /**
+         * Read the config data on first call. It need to be call before
+         * any other access.
+         *
+         * @return                      GPSDOG_CONF_LOAD_* status of the read
          */
-        void readConfig();
+        uint8_t loadConfig();
 
         /**
-         * Write data to EEPROM
+         * Write all changed parts of data as one record to EEPROM journal,
+         * it is from the first to the last changed byte. So a power loss
+         * keep the old or the new data, never a part of it. If nothing is
+         * changed or a transaction is open, it does nothing.
          */
         void writeConfig();
 
+        /**
+         * Start a transaction. All changes of config data and contacts
+         * after this are only in RAM until @see commitConfig.
+         */
+        void beginConfig();
+
+        /**
+         * Close the transaction and write all changes to EEPROM, the
+         * contacts first.
+         */
+        void commitConfig();
+
+        /**
+         * Close the transaction and restore config data from begin. The
+         * staged contacts are dropped.
+         */
+        void abortConfig();
+
+        /**
+         * Get the count of bytes they are written to EEPROM.
+         */
+        uint32_t getEEPROMWrites() {
+            return m_eepromWrites;
+        }
+
         /**
          * Write a new number to config store.
          * 
@@ -137,13 +449,29 @@ class GDConfig
         bool setStoreNumber(uint8_t numStoreIdx, char *num, uint8_t sign);
 
         /**
-         * Check is the number equal to the number in config store.
+         * Delete a number from config store with notify information.
          *
          * @param numStoreIdx           Index of config store number.
-         * @param num                   Number for check
-         * @return                      TRUE / FALSE is the number equal
          */
-        bool checkStoreNumber(uint8_t numStoreIdx, char *num);
+        void delStoreNumber(uint8_t numStoreIdx);
+
+        /**
+         * Read a number from config store. The buffer is valid until the
+         * next call.
+         *
+         * @param numStoreIdx           Index of config store number.
+         * @return                      Number or empty string
+         */
+        char* getStoreNumber(uint8_t numStoreIdx);
+
+        /**
+         * Search in store for the index of number. The significant digits
+         * of a store number (after sign) need to be the end of the number.
+         *
+         * @param num                   Number for search
+         * @return                      Index or GPSDOG_CONF_NUMBER_STORE
+         */
+        uint8_t getNumberIdxInStore(char *num);
 
         /**
          * Search in store for the number.
@@ -211,11 +539,14 @@ class GDConfig
          * - GPSDOG_MODE_ALARM
          * - GPSDOG_MODE_PROTECT
          * - GPSDOG_MODE_FORWARD
+         * - GPSDOG_MODE_DOWATCH
          *
          * @param mode                  Mode they will check
          * @return                      TRUE is active or FALSE
          */
-        bool isModeOn(uint8_t mode);
+        bool isModeOn(uint8_t mode) {
+            return (m_data.m_modes & mode) != 0x00;
+        }
 
         /**
          * Set mode on or off. @see isModeOn.
@@ -237,6 +568,7 @@ class GDConfig
          */
         void setAlarmInterval(uint8_t val) {
             m_data.m_alarmInterval = val;
+            GPSDOG_CONF_DIRTY(m_alarmInterval);
         }
 
          /**
@@ -252,45 +584,48 @@ class GDConfig
         void setForwardIdx(uint8_t val);
 
         /**
-         * Getter for GPS Latitude in config store
+         * Getter for GPS Latitude in config store in microdegrees
          */
-        double getStoreLatitude() {
+        int32_t getStoreLatitude() {
             return m_data.m_latitude;
         }
 
         /**
-         * Setter for GPS Latitude in config store
+         * Setter for GPS Latitude in config store in microdegrees
          */
-        void setStoreLatitude(double lat) {
+        void setStoreLatitude(int32_t lat) {
             m_data.m_latitude = lat;
+            GPSDOG_CONF_DIRTY(m_latitude);
         }
 
         /**
-         * Getter for GPS Longitude in config store
+         * Getter for GPS Longitude in config store in microdegrees
          */
-        double getStoreLongitude() {
+        int32_t getStoreLongitude() {
             return m_data.m_longitude;
         }
 
         /**
-         * Setter for GPS Longitude in config store
+         * Setter for GPS Longitude in config store in microdegrees
          */
-        void setStoreLongitude(double lon) {
+        void setStoreLongitude(int32_t lon) {
             m_data.m_longitude = lon;
+            GPSDOG_CONF_DIRTY(m_longitude);
         }
 
         /**
-         * Getter for GPS GeoFix 
+         * Getter for watch geofence radius in meters
          */
-        double getStoreGeoFix() {
-            return m_data.m_geoFix;
+        uint16_t getStoreGeoRadius() {
+            return m_data.m_geoRadius;
         }
 
         /**
-         * Setter for GPS GeoFix
+         * Setter for watch geofence radius in meters
          */
-        void setStoreGeoFix(double geoFix) {
-            m_data.m_geoFix = geoFix;
+        void setStoreGeoRadius(uint16_t radius) {
+            m_data.m_geoRadius = radius;
+            GPSDOG_CONF_DIRTY(m_geoRadius);
         }
 
         /**
@@ -302,6 +637,7 @@ class GDConfig
          */
         void setUnit(uint8_t unit) {
             m_data.m_unit = unit;
+            GPSDOG_CONF_DIRTY(m_unit);
         }
 
         /**
@@ -310,6 +646,51 @@ class GDConfig
         uint8_t getUnit() {
             return m_data.m_unit;
         }
+
+        /**
+         * Getter for count of outside fixes in a row they fire the alarm
+         */
+        uint8_t getFilterConfirm() {
+            return m_data.m_filterConfirm;
+        }
+
+        /**
+         * Setter for count of outside fixes in a row they fire the alarm
+         */
+        void setFilterConfirm(uint8_t confirm) {
+            m_data.m_filterConfirm = confirm;
+            GPSDOG_CONF_DIRTY(m_filterConfirm);
+        }
+
+        /**
+         * Getter for max. possible speed in km/h, 0 is off
+         */
+        uint16_t getFilterSpeed() {
+            return m_data.m_filterSpeed;
+        }
+
+        /**
+         * Setter for max. possible speed in km/h, 0 is off
+         */
+        void setFilterSpeed(uint16_t speed) {
+            m_data.m_filterSpeed = speed;
+            GPSDOG_CONF_DIRTY(m_filterSpeed);
+        }
+
+        /**
+         * Getter for window size of median filter, 1 is off
+         */
+        uint8_t getFilterMedian() {
+            return m_data.m_filterMedian;
+        }
+
+        /**
+         * Setter for window size of median filter, 1 is off
+         */
+        void setFilterMedian(uint8_t median) {
+            m_data.m_filterMedian = median;
+            GPSDOG_CONF_DIRTY(m_filterMedian);
+        }
 };
 
 #endif
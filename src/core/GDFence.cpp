@@ -0,0 +1,242 @@
+
+#include "GDFence.h"
+
+// zone store need to fit into EEPROM
+static_assert(GPSDOG_FENCE_START + GPSDOG_FENCE_COUNT * sizeof(GD_FENCE_ZONE) <= E2END + 1, "Zone store is to big for EEPROM");
+
+GDFence::GDFence()
+{
+    memset(m_fenceType, GPSDOG_FENCE_NONE, sizeof(m_fenceType));
+}
+
+void GDFence::loadFence()
+{
+    GD_FENCE_ZONE zone;
+
+    for (uint8_t i = 0; i < GPSDOG_FENCE_COUNT; i++) {
+        m_fenceType[i] = GPSDOG_FENCE_NONE;
+
+        if (this->readZone(i, &zone)) {
+            this->boxZone(i, &zone);
+        }
+    }
+}
+
+void GDFence::cleanFence()
+{
+    for (uint8_t i = 0; i < GPSDOG_FENCE_COUNT; i++) {
+        this->delFence(i);
+    }
+}
+
+uint8_t GDFence::crcZone(GD_FENCE_ZONE *zone)
+{
+    uint8_t *p  = reinterpret_cast<uint8_t*>(zone);
+    uint8_t crc = 0x00;
+
+    for (uint8_t i = 0; i < offsetof(GD_FENCE_ZONE, m_crc); i++) {
+        crc = _crc8_ccitt_update(crc, p[i]);
+    }
+
+    return crc;
+}
+
+bool GDFence::readZone(uint8_t idx, GD_FENCE_ZONE *zone)
+{
+    uint8_t     *p      = reinterpret_cast<uint8_t*>(zone);
+    uint16_t    addr    = GPSDOG_FENCE_START + idx * sizeof(GD_FENCE_ZONE);
+
+    for (uint8_t i = 0; i < sizeof(GD_FENCE_ZONE); i++) {
+        p[i] = EEPROM.read(addr + i);
+    }
+
+    // empty or broken
+    if (zone->m_type == GPSDOG_FENCE_NONE || zone->m_crc != crcZone(zone)) {
+        return false;
+    }
+
+    // secure count
+    if (zone->m_type == GPSDOG_FENCE_POLYGON && (zone->m_count < 3 || zone->m_count > GPSDOG_FENCE_POINTS)) {
+        return false;
+    }
+
+    return true;
+}
+
+void GDFence::writeZone(uint8_t idx, GD_FENCE_ZONE *zone)
+{
+    uint8_t     *p      = reinterpret_cast<uint8_t*>(zone);
+    uint16_t    addr    = GPSDOG_FENCE_START + idx * sizeof(GD_FENCE_ZONE);
+
+    zone->m_crc = crcZone(zone);
+
+    for (uint8_t i = 0; i < sizeof(GD_FENCE_ZONE); i++) {
+        EEPROM.update(addr + i, p[i]);
+    }
+
+    m_fenceType[idx] = GPSDOG_FENCE_NONE;
+
+    if (zone->m_type != GPSDOG_FENCE_NONE) {
+        this->boxZone(idx, zone);
+    }
+}
+
+void GDFence::boxZone(uint8_t idx, GD_FENCE_ZONE *zone)
+{
+    GD_FENCE_BOX    *box = &m_fenceBox[idx];
+    uint32_t        dLat;
+    uint32_t        dLon;
+
+    ////
+    // Circle
+    if (zone->m_type == GPSDOG_FENCE_CIRCLE) {
+        // meters to microdegrees (+1 for rounding)
+        dLat = (static_cast<uint32_t>(zone->m_radius) << 14) / GPSDOG_GPS_METER_MUL + 1;
+        dLon = static_cast<uint64_t>(dLat) * GPSDOG_GPS_COS_ONE / zone->m_cos + 1;
+
+        box->m_latMin = zone->m_lat[0] - dLat;
+        box->m_latMax = zone->m_lat[0] + dLat;
+        box->m_lonMin = zone->m_lon[0] - dLon;
+        box->m_lonMax = zone->m_lon[0] + dLon;
+    }
+    ////
+    // Polygon
+    else {
+        box->m_latMin = box->m_latMax = zone->m_lat[0];
+        box->m_lonMin = box->m_lonMax = zone->m_lon[0];
+
+        for (uint8_t i = 1; i < zone->m_count; i++) {
+            if (zone->m_lat[i] < box->m_latMin) {
+                box->m_latMin = zone->m_lat[i];
+            }
+            if (zone->m_lat[i] > box->m_latMax) {
+                box->m_latMax = zone->m_lat[i];
+            }
+            if (zone->m_lon[i] < box->m_lonMin) {
+                box->m_lonMin = zone->m_lon[i];
+            }
+            if (zone->m_lon[i] > box->m_lonMax) {
+                box->m_lonMax = zone->m_lon[i];
+            }
+        }
+    }
+
+    m_fenceType[idx] = zone->m_type;
+}
+
+bool GDFence::setFenceCircle(uint8_t idx, int32_t lat, int32_t lon, uint16_t radius)
+{
+    GD_FENCE_ZONE zone;
+
+    // index & value secure
+    if (idx >= GPSDOG_FENCE_COUNT || radius == 0 || radius > GPSDOG_GPS_RADIUS_MAX) {
+        return false;
+    }
+
+    memset(&zone, 0x00, sizeof(GD_FENCE_ZONE));
+
+    zone.m_type     = GPSDOG_FENCE_CIRCLE;
+    zone.m_radius   = radius;
+    zone.m_cos      = GDGps::getCosLatitude(lat);
+    zone.m_lat[0]   = lat;
+    zone.m_lon[0]   = lon;
+
+    this->writeZone(idx, &zone);
+
+    return true;
+}
+
+bool GDFence::setFencePolygon(uint8_t idx, int32_t *lat, int32_t *lon, uint8_t count)
+{
+    GD_FENCE_ZONE zone;
+
+    // index & value secure
+    if (idx >= GPSDOG_FENCE_COUNT || count < 3 || count > GPSDOG_FENCE_POINTS) {
+        return false;
+    }
+
+    memset(&zone, 0x00, sizeof(GD_FENCE_ZONE));
+
+    zone.m_type     = GPSDOG_FENCE_POLYGON;
+    zone.m_count    = count;
+
+    memcpy(zone.m_lat, lat, count * sizeof(int32_t));
+    memcpy(zone.m_lon, lon, count * sizeof(int32_t));
+
+    this->writeZone(idx, &zone);
+
+    return true;
+}
+
+void GDFence::delFence(uint8_t idx)
+{
+    GD_FENCE_ZONE zone;
+
+    // index secure
+    if (idx >= GPSDOG_FENCE_COUNT) {
+        return;
+    }
+
+    memset(&zone, 0x00, sizeof(GD_FENCE_ZONE));
+
+    this->writeZone(idx, &zone);
+}
+
+bool GDFence::isInPolygon(GD_FENCE_ZONE *zone, int32_t lat, int32_t lon)
+{
+    bool    inside  = false;
+    int64_t lhs;
+    int64_t rhs;
+
+    for (uint8_t i = 0, y = zone->m_count -1; i < zone->m_count; y = i++) {
+
+        // edge cross the latitude of point
+        if ((zone->m_lat[i] > lat) == (zone->m_lat[y] > lat)) {
+            continue;
+        }
+
+        // point is left of edge
+        lhs = static_cast<int64_t>(lon - zone->m_lon[i]) * (zone->m_lat[y] - zone->m_lat[i]);
+        rhs = static_cast<int64_t>(lat - zone->m_lat[i]) * (zone->m_lon[y] - zone->m_lon[i]);
+
+        if (zone->m_lat[y] > zone->m_lat[i] ? lhs < rhs : lhs > rhs) {
+            inside = !inside;
+        }
+    }
+
+    return inside;
+}
+
+bool GDFence::isInFence(int32_t lat, int32_t lon)
+{
+    GD_FENCE_ZONE   zone;
+    GD_FENCE_BOX    *box;
+
+    for (uint8_t i = 0; i < GPSDOG_FENCE_COUNT; i++) {
+        box = &m_fenceBox[i];
+
+        // prefilter with bounding box
+        if (m_fenceType[i] == GPSDOG_FENCE_NONE || lat < box->m_latMin || lat > box->m_latMax || lon < box->m_lonMin || lon > box->m_lonMax) {
+            continue;
+        }
+
+        if (!this->readZone(i, &zone)) {
+            continue;
+        }
+
+        // circle
+        if (zone.m_type == GPSDOG_FENCE_CIRCLE) {
+            if (GDGps::isInRadius(zone.m_lat[0], zone.m_lon[0], zone.m_cos, lat, lon, zone.m_radius)) {
+                return true;
+            }
+        }
+        // polygon
+        else if (isInPolygon(&zone, lat, lon)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
@@ -0,0 +1,174 @@
+
+#ifndef GDFENCE_H
+#define GDFENCE_H
+
+// includes
+#include <EEPROM.h>
+#include <inttypes.h>
+#include <string.h>
+#include <util/crc16.h>
+
+#include "GDConfig.h"
+#include "GDGps.h"
+
+// config
+#define GPSDOG_FENCE_COUNT 0x04
+#define GPSDOG_FENCE_POINTS 0x06
+
+// EEPROM zone store after the contact store
+#define GPSDOG_FENCE_START (GPSDOG_CONF_CONTACT_START + GPSDOG_CONF_NUMBER_STORE * GPSDOG_CONF_CONTACT_SIZE)
+
+// zone type
+#define GPSDOG_FENCE_NONE 0x00
+#define GPSDOG_FENCE_CIRCLE 0x01
+#define GPSDOG_FENCE_POLYGON 0x02
+
+/**
+ * Zone in EEPROM
+ */
+struct GD_FENCE_ZONE
+{
+    /** GPSDOG_FENCE_* type */
+    uint8_t     m_type;
+
+    /** Count of polygon points */
+    uint8_t     m_count;
+
+    /** Circle radius in meters */
+    uint16_t    m_radius;
+
+    /** cos of circle latitude as Q14 */
+    uint16_t    m_cos;
+
+    /** Polygon points or circle center (first) in microdegrees */
+    int32_t     m_lat[GPSDOG_FENCE_POINTS];
+    int32_t     m_lon[GPSDOG_FENCE_POINTS];
+
+    /** CRC8 over all data before */
+    uint8_t     m_crc;
+};
+
+/**
+ * Bounding box of a zone in RAM
+ */
+struct GD_FENCE_BOX
+{
+    int32_t     m_latMin;
+    int32_t     m_latMax;
+    int32_t     m_lonMin;
+    int32_t     m_lonMax;
+};
+
+/**
+ * Object for geofence zones. Every zone is a allowed area. The zones are
+ * in EEPROM, only the bounding boxes are in RAM as a prefilter.
+ */
+class GDFence
+{
+    private:
+
+        /** Bounding box of every zone */
+        GD_FENCE_BOX    m_fenceBox[GPSDOG_FENCE_COUNT];
+
+        /** GPSDOG_FENCE_* type of every zone */
+        uint8_t         m_fenceType[GPSDOG_FENCE_COUNT];
+
+        /**
+         * Calc CRC8 over a zone.
+         *
+         * @param zone              Zone
+         * @return                  CRC8 value
+         */
+        static uint8_t crcZone(GD_FENCE_ZONE *zone);
+
+        /**
+         * Read a zone from EEPROM.
+         *
+         * @param idx               Index of zone
+         * @param zone              Buffer for zone
+         * @return                  FALSE if zone is empty or broken
+         */
+        bool readZone(uint8_t idx, GD_FENCE_ZONE *zone);
+
+        /**
+         * Write a zone to EEPROM and update the bounding box.
+         *
+         * @param idx               Index of zone
+         * @param zone              Zone
+         */
+        void writeZone(uint8_t idx, GD_FENCE_ZONE *zone);
+
+        /**
+         * Calc the bounding box of a zone.
+         *
+         * @param idx               Index of zone
+         * @param zone              Zone
+         */
+        void boxZone(uint8_t idx, GD_FENCE_ZONE *zone);
+
+        /**
+         * Check is a position inside a polygon (crossing number).
+         *
+         * @param zone              Zone with polygon
+         * @param lat               Latitude in microdegrees
+         * @param lon               Longitude in microdegrees
+         * @return                  TRUE is inside
+         */
+        static bool isInPolygon(GD_FENCE_ZONE *zone, int32_t lat, int32_t lon);
+
+    public:
+
+        GDFence();
+
+        /**
+         * Read all zones from EEPROM and calc the bounding boxes.
+         */
+        void loadFence();
+
+        /**
+         * Delete all zones.
+         */
+        void cleanFence();
+
+        /**
+         * Set a circle zone.
+         *
+         * @param idx               Index of zone
+         * @param lat               Center latitude in microdegrees
+         * @param lon               Center longitude in microdegrees
+         * @param radius            Radius in meters
+         * @return                  TRUE if success
+         */
+        bool setFenceCircle(uint8_t idx, int32_t lat, int32_t lon, uint16_t radius);
+
+        /**
+         * Set a polygon zone.
+         *
+         * @param idx               Index of zone
+         * @param lat               Array of latitude in microdegrees
+         * @param lon               Array of longitude in microdegrees
+         * @param count             Count of points (3 - GPSDOG_FENCE_POINTS)
+         * @return                  TRUE if success
+         */
+        bool setFencePolygon(uint8_t idx, int32_t *lat, int32_t *lon, uint8_t count);
+
+        /**
+         * Delete a zone.
+         *
+         * @param idx               Index of zone
+         */
+        void delFence(uint8_t idx);
+
+        /**
+         * Check is a position inside of a zone.
+         *
+         * @param lat               Latitude in microdegrees
+         * @param lon               Longitude in microdegrees
+         * @return                  TRUE is inside of one zone
+         */
+        bool isInFence(int32_t lat, int32_t lon);
+};
+
+#endif
+
+// vim: set sts=4 sw=4 ts=4 et:
@@ -0,0 +1,117 @@
+
+#include "GDFilter.h"
+
+GDFilter::GDFilter()
+{
+    this->resetFilter();
+}
+
+void GDFilter::resetFilter()
+{
+    m_filterPos     ^= m_filterPos;
+    m_filterFill    ^= m_filterFill;
+    m_lastTime      ^= m_lastTime;
+    m_lastCos       ^= m_lastCos;
+    m_rejectCount   ^= m_rejectCount;
+    m_outsideCount  ^= m_outsideCount;
+}
+
+int32_t GDFilter::getMedian(int32_t *values, uint8_t count)
+{
+    int32_t sort[GPSDOG_FILTER_MEDIAN_MAX];
+    int32_t val;
+    uint8_t y;
+
+    for (uint8_t i = 0; i < count; i++) {
+        val = values[i];
+
+        for (y = i; y > 0 && sort[y -1] > val; y--) {
+            sort[y] = sort[y -1];
+        }
+
+        sort[y] = val;
+    }
+
+    return sort[count / 2];
+}
+
+bool GDFilter::filterFix(int32_t *lat, int32_t *lon, uint32_t now, uint16_t maxSpeed, uint8_t median)
+{
+    int32_t     lats[GPSDOG_FILTER_MEDIAN_MAX];
+    int32_t     lons[GPSDOG_FILTER_MEDIAN_MAX];
+    uint32_t    tenth;
+    uint32_t    allowed;
+    uint8_t     count;
+    uint8_t     idx;
+
+    ////
+    // Speed check, skip the first fix
+    if (maxSpeed > 0 && m_lastCos > 0 && m_rejectCount < GPSDOG_FILTER_REJECT_MAX) {
+        // time in 1/10 sec (rollover safe)
+        tenth = (now - m_lastTime) / 100;
+
+        // meters they are possible since last fix
+        if (tenth <= 0xFFFF) {
+            allowed = static_cast<uint32_t>(maxSpeed) * tenth / 36 + GPSDOG_FILTER_SLACK;
+
+            if (allowed <= GPSDOG_GPS_RADIUS_MAX && !GDGps::isInRadius(m_lastLat, m_lastLon, m_lastCos, *lat, *lon, allowed)) {
+                m_rejectCount++;
+                return false;
+            }
+        }
+    }
+
+    ////
+    // Accept fix
+    if (m_lastCos == 0 || m_rejectCount >= GPSDOG_FILTER_REJECT_MAX) {
+        // it is a new start, old window is not valid
+        m_filterFill    ^= m_filterFill;
+        m_lastCos       = GDGps::getCosLatitude(*lat);
+    }
+
+    m_lastLat       = *lat;
+    m_lastLon       = *lon;
+    m_lastTime      = now;
+    m_rejectCount   ^= m_rejectCount;
+
+    m_filterLat[m_filterPos]    = *lat;
+    m_filterLon[m_filterPos]    = *lon;
+    m_filterPos                 = (m_filterPos + 1) % GPSDOG_FILTER_MEDIAN_MAX;
+
+    if (m_filterFill < GPSDOG_FILTER_MEDIAN_MAX) {
+        m_filterFill++;
+    }
+
+    ////
+    // Median over the last fixes
+    count = median < m_filterFill ? median : m_filterFill;
+
+    if (count > 1) {
+        for (uint8_t i = 0; i < count; i++) {
+            idx     = (m_filterPos + GPSDOG_FILTER_MEDIAN_MAX - 1 - i) % GPSDOG_FILTER_MEDIAN_MAX;
+            lats[i] = m_filterLat[idx];
+            lons[i] = m_filterLon[idx];
+        }
+
+        *lat = getMedian(lats, count);
+        *lon = getMedian(lons, count);
+    }
+
+    return true;
+}
+
+bool GDFilter::confirmOutside(bool outside, uint8_t confirm)
+{
+    if (!outside) {
+        m_outsideCount ^= m_outsideCount;
+        return false;
+    }
+
+    if (m_outsideCount < 0xFF) {
+        m_outsideCount++;
+    }
+
+    return m_outsideCount >= confirm;
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
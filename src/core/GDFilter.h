@@ -0,0 +1,109 @@
+
+#ifndef GDFILTER_H
+#define GDFILTER_H
+
+// includes
+#include <inttypes.h>
+#include <string.h>
+
+#include "GDGps.h"
+
+// config
+#define GPSDOG_FILTER_MEDIAN_MAX 0x05
+#define GPSDOG_FILTER_CONFIRM_MAX 0x0A
+#define GPSDOG_FILTER_SPEED_MAX 1000
+
+// defaults
+#define GPSDOG_FILTER_CONFIRM_DEF 0x02
+#define GPSDOG_FILTER_SPEED_DEF 300
+#define GPSDOG_FILTER_MEDIAN_DEF 0x01
+
+// meters of GPS noise they is allways allowed
+#define GPSDOG_FILTER_SLACK 30
+
+// after this count of rejected fixes, the next fix is the new start
+#define GPSDOG_FILTER_REJECT_MAX 0x05
+
+/**
+ * Object for filter the GPS fixes before the watch check. A single
+ * jump of the position (multipath) should not fire a alarm.
+ *
+ * The stages are:
+ * - Reject a fix if the speed from last fix is impossible
+ * - Median over the last fixes (window 1 is off)
+ * - Alarm only if N fixes in a row are outside
+ */
+class GDFilter
+{
+    private:
+
+        /** Window of the last accepted fixes for median */
+        int32_t     m_filterLat[GPSDOG_FILTER_MEDIAN_MAX];
+        int32_t     m_filterLon[GPSDOG_FILTER_MEDIAN_MAX];
+        uint8_t     m_filterPos;
+        uint8_t     m_filterFill;
+
+        /** Last accepted fix for speed check */
+        int32_t     m_lastLat;
+        int32_t     m_lastLon;
+        uint32_t    m_lastTime;
+        uint16_t    m_lastCos;
+
+        /** Count of rejected fixes in a row */
+        uint8_t     m_rejectCount;
+
+        /** Count of outside fixes in a row */
+        uint8_t     m_outsideCount;
+
+        /**
+         * Median of a window. Window size is small, so a insert sort
+         * is okay.
+         *
+         * @param values            Window
+         * @param count             Count of values
+         * @return                  Median
+         */
+        static int32_t getMedian(int32_t *values, uint8_t count);
+
+    public:
+
+        GDFilter();
+
+        /**
+         * Clear all state. The next fix is accepted without checks.
+         */
+        void resetFilter();
+
+        /**
+         * Check a new fix and put it into the median window.
+         *
+         * @param lat               Latitude in microdegrees, set to median
+         * @param lon               Longitude in microdegrees, set to median
+         * @param now               Time of fix in ms
+         * @param maxSpeed          Max. possible speed in km/h, 0 is off
+         * @param median            Window size for median, 1 is off
+         * @return                  FALSE if the fix is a jump
+         */
+        bool filterFix(int32_t *lat, int32_t *lon, uint32_t now, uint16_t maxSpeed, uint8_t median);
+
+        /**
+         * Count the outside fixes in a row.
+         *
+         * @param outside           TRUE if fix is outside
+         * @param confirm           Count of fixes they need for confirm
+         * @return                  TRUE if outside is confirmed
+         */
+        bool confirmOutside(bool outside, uint8_t confirm);
+
+        /**
+         * Clear the count of outside fixes, if the watch point is set or
+         * the watch is stopped.
+         */
+        void resetOutside() {
+            m_outsideCount ^= m_outsideCount;
+        }
+};
+
+#endif
+
+// vim: set sts=4 sw=4 ts=4 et:
@@ -17,31 +17,43 @@ void GDGps::copyDateTime(char *date, char *time)
     strncpy(m_time, time, GPSDOG_GPS_TIME_SIZE);
 }
 
-uint8_t GDGps::removeSpace(char *buffer, uint8_t size)
+uint8_t GDGps::writeFixed(char *buffer, uint8_t size, int32_t val, uint8_t digits)
 {
-    bool dataStart = false;
+    char        tmp[12];
+    uint8_t     len = 0;
+    uint8_t     pos = 0;
+    uint32_t    abs = val < 0 ? -static_cast<uint32_t>(val) : val;
+
+    ////
+    // Digits in reverse order / one digit before point
+    do {
+        tmp[len++]  = '0' + abs % 10;
+        abs         /= 10;
+    } while (abs > 0 || len <= digits);
+
+    // sign + point + '\0'
+    if (len + (val < 0 ? 1 : 0) + (digits > 0 ? 1 : 0) + 1 > size) {
+        buffer[0] = 0x00;
+        return 0;
+    }
 
-    // no space
-    if (buffer[0] == 0x20) {
-        // copy data
-        for (uint8_t i = 0, y = 0; size > y; i++) {
+    ////
+    // Write
+    if (val < 0) {
+        buffer[pos++] = '-';
+    }
 
-            // eof
-            if (i >= size) {
-                buffer[y++] = 0x00;
-            }
-            // copy data
-            else if (dataStart) {
-                buffer[y++] = buffer[i];
-            }
-            else if (buffer[i] != 0x20) {
-                dataStart   = true;
-                buffer[y++] = buffer[i];
-            }
+    while (len > 0) {
+        if (len == digits) {
+            buffer[pos++] = '.';
         }
+
+        buffer[pos++] = tmp[--len];
     }
 
-    return static_cast<uint8_t>(strlen(buffer));
+    buffer[pos] = 0x00;
+
+    return pos;
 }
 
 uint8_t GDGps::getLatitude(char *buffer, uint8_t size)
@@ -51,11 +63,7 @@ uint8_t GDGps::getLatitude(char *buffer, uint8_t size)
         return 0;
     }
 
-    // convert
-    memset(buffer, 0x00, size);
-    dtostrf(m_latitude, 11, 6, buffer);
-
-    return this->removeSpace(buffer, size);
+    return writeFixed(buffer, size, m_latitude, GPSDOG_GPS_GEO_DIGITS);
 }
 
 uint8_t GDGps::getLongitude(char *buffer, uint8_t size)
@@ -65,11 +73,7 @@ uint8_t GDGps::getLongitude(char *buffer, uint8_t size)
         return 0;
     }
 
-    // convert
-    memset(buffer, 0x00, size);
-    dtostrf(m_longitude, 11, 6, buffer);
-
-    return this->removeSpace(buffer, size);
+    return writeFixed(buffer, size, m_longitude, GPSDOG_GPS_GEO_DIGITS);
 }
 
 uint8_t GDGps::getSpeed(char *buffer, uint8_t size)
@@ -79,28 +83,149 @@ uint8_t GDGps::getSpeed(char *buffer, uint8_t size)
         return 0;
     }
 
-    // convert
-    memset(buffer, 0x00, size);
-    dtostrf(m_speed, 6, 2, buffer);
+    return writeFixed(buffer, size, m_speed, GPSDOG_GPS_SPEED_DIGITS);
+}
+
+uint8_t GDGps::parseGeoValue(const char *str, uint8_t size, int32_t *val)
+{
+    uint8_t     pos     = 0;
+    uint8_t     digits  = 0;
+    uint32_t    abs     = 0;
+    bool        neg     = false;
+    bool        point   = false;
+    bool        found   = false;
+
+    // sign
+    if (pos < size && (str[pos] == '-' || str[pos] == '+')) {
+        neg = str[pos++] == '-';
+    }
+
+    ////
+    // Digits
+    for (; pos < size; pos++) {
+        if (str[pos] == '.' && !point) {
+            point = true;
+        }
+        else if (str[pos] >= '0' && str[pos] <= '9') {
+            // ignore more digits as microdegrees
+            if (point && digits >= GPSDOG_GPS_GEO_DIGITS) {
+                continue;
+            }
+            // max 180°
+            if (!point && abs > 180) {
+                return 0;
+            }
+
+            abs     = abs * 10 + (str[pos] - '0');
+            found   = true;
+
+            if (point) {
+                digits++;
+            }
+        }
+        else {
+            break;
+        }
+    }
+
+    // no number
+    if (!found) {
+        return 0;
+    }
+
+    // fill up digits
+    if (!point) {
+        abs *= GPSDOG_GPS_GEO_SCALE;
+    }
+    else {
+        for (; digits < GPSDOG_GPS_GEO_DIGITS; digits++) {
+            abs *= 10;
+        }
+    }
+
+    *val = neg ? -static_cast<int32_t>(abs) : abs;
+
+    return pos;
+}
+
+bool GDGps::parseGeoPoint(const char *str, uint8_t size, int32_t *lat, int32_t *lon)
+{
+    uint8_t len = parseGeoValue(str, size, lat);
+
+    // lat,
+    if (len == 0 || len >= size || str[len] != ',') {
+        return false;
+    }
+
+    len++;
+
+    // lon is missing
+    if (len >= size) {
+        return false;
+    }
+
+    // lon / hole string
+    if (parseGeoValue(str + len, size - len, lon) != size - len) {
+        return false;
+    }
+
+    // range
+    if (*lat > 90 * GPSDOG_GPS_GEO_SCALE || *lat < -90 * GPSDOG_GPS_GEO_SCALE || *lon > 180 * GPSDOG_GPS_GEO_SCALE || *lon < -180 * GPSDOG_GPS_GEO_SCALE) {
+        return false;
+    }
+
+    return true;
+}
+
+uint16_t GDGps::getCosLatitude(int32_t lat)
+{
+    double val = cos(lat / static_cast<double>(GPSDOG_GPS_GEO_SCALE) * M_PI / 180.0) * GPSDOG_GPS_COS_ONE;
+
+    // 0 is not calc
+    return val > 1.0 ? static_cast<uint16_t>(val) : 1;
+}
 
-    return this->removeSpace(buffer, size);
+bool GDGps::isGoodFix(uint8_t fixType, uint8_t sats, uint16_t hdop)
+{
+    return fixType >= GPSDOG_GPS_QUALITY_FIX && sats >= GPSDOG_GPS_QUALITY_SATS && hdop <= GPSDOG_GPS_QUALITY_HDOP;
 }
 
-bool GDGps::cmpGeoData(double a, double b, double geoFix)
+uint32_t GDGps::toMeters(int32_t diff)
 {
-    double val = a - b;
+    uint32_t val = diff < 0 ? -static_cast<uint32_t>(diff) : diff;
 
-    // negative
-    if (val < 0.0) {
-        val *= -1;
+    // overflow secure, it is far away of every radius
+    if (val > GPSDOG_GPS_METER_MAX_DIFF) {
+        val = GPSDOG_GPS_METER_MAX_DIFF;
     }
 
-    // compare with 0.0001 percent
-    if (val < geoFix || val == 0.0) {
-        return true;
+    return (val * GPSDOG_GPS_METER_MUL) >> 14;
+}
+
+bool GDGps::isInRadius(int32_t lat0, int32_t lon0, uint16_t cosLat, int32_t lat, int32_t lon, uint16_t radius)
+{
+    int32_t     dLon    = lon - lon0;
+    uint32_t    x;
+    uint32_t    y;
+
+    // over 180°
+    if (dLon > 180 * GPSDOG_GPS_GEO_SCALE) {
+        dLon -= 360 * GPSDOG_GPS_GEO_SCALE;
+    }
+    else if (dLon < -180 * GPSDOG_GPS_GEO_SCALE) {
+        dLon += 360 * GPSDOG_GPS_GEO_SCALE;
+    }
+
+    // meters
+    y = toMeters(lat - lat0);
+    x = (toMeters(dLon) * cosLat) >> 14;
+
+    // every axis allone is out
+    if (x > radius || y > radius) {
+        return false;
     }
 
-    return false;
+    return x * x + y * y <= static_cast<uint32_t>(radius) * radius;
 }
 
 // vim: set sts=4 sw=4 ts=4 et:
@@ -6,12 +6,51 @@
 #include <inttypes.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 
 // data size
 // the real size is SIZE+1 for char buffer
 #define GPSDOG_GPS_DATE_SIZE 10
 #define GPSDOG_GPS_TIME_SIZE 5
 
+// coordinates are in microdegrees, speed in 1/100
+#define GPSDOG_GPS_GEO_SCALE 1000000L
+#define GPSDOG_GPS_GEO_DIGITS 6
+#define GPSDOG_GPS_SPEED_SCALE 100
+#define GPSDOG_GPS_SPEED_DIGITS 2
+
+// geofence radius in meters
+#define GPSDOG_GPS_RADIUS_DEF 50
+#define GPSDOG_GPS_RADIUS_MAX 40000
+
+// meters per microdegree as (x * MUL) >> 14 / max microdegrees without overflow
+#define GPSDOG_GPS_METER_MUL 1824
+#define GPSDOG_GPS_METER_MAX_DIFF 2300000L
+
+// cos(latitude) as Q14
+#define GPSDOG_GPS_COS_ONE 16384
+
+// fix type like NMEA GSA
+#define GPSDOG_GPS_FIX_NONE 0x01
+#define GPSDOG_GPS_FIX_2D 0x02
+#define GPSDOG_GPS_FIX_3D 0x03
+
+// quality of a good fix, HDOP in 1/100
+#ifndef GPSDOG_GPS_QUALITY_FIX
+#define GPSDOG_GPS_QUALITY_FIX GPSDOG_GPS_FIX_3D
+#endif
+#ifndef GPSDOG_GPS_QUALITY_SATS
+#define GPSDOG_GPS_QUALITY_SATS 5
+#endif
+#ifndef GPSDOG_GPS_QUALITY_HDOP
+#define GPSDOG_GPS_QUALITY_HDOP 200
+#endif
+
+// count of good fixes in a row they make the position fix
+#ifndef GPSDOG_GPS_QUALITY_SAMPLES
+#define GPSDOG_GPS_QUALITY_SAMPLES 3
+#endif
+
 /**
  * Object for store gps data
  */
@@ -20,26 +59,28 @@ class GDGps
     protected:
 
         /** 
-         * Remove leading space from dtostrf
+         * Write a fixed-point value as decimal string.
          *
-         * @param buffer            Buffer to Copy latitude
+         * @param buffer            Buffer for the string
          * @param size              Max Size of buffer
+         * @param val               Value
+         * @param digits            Count of digits after the point
          * @return                  Char they have written to buffer
          */
-        uint8_t removeSpace(char *buffer, uint8_t size);
+        static uint8_t writeFixed(char *buffer, uint8_t size, int32_t val, uint8_t digits);
 
     public:
 
         GDGps();
 
-        /** Latitude */
-        double m_latitude;
+        /** Latitude in microdegrees */
+        int32_t m_latitude;
 
-        /** Longitude */
-        double m_longitude;
+        /** Longitude in microdegrees */
+        int32_t m_longitude;
 
-        /** Speed */
-        double m_speed;
+        /** Speed in 1/100 KMH or MPH */
+        uint16_t m_speed;
 
         /** Date in format YYYY-MM-DD */
         char m_date[GPSDOG_GPS_DATE_SIZE +1];
@@ -86,14 +127,69 @@ class GDGps
         uint8_t getSpeed(char *buffer, uint8_t size);
 
         /**
-         * Compare 2 GPS coordinate. 
+         * Calc cos(latitude) for @see isInRadius. It use float math, so
+         * call it only if the center change.
+         *
+         * @param lat               Latitude in microdegrees
+         * @return                  cos(latitude) as Q14
+         */
+        static uint16_t getCosLatitude(int32_t lat);
+
+        /**
+         * Check is the quality of a fix good enough, see
+         * GPSDOG_GPS_QUALITY_*.
+         *
+         * @param fixType           GPSDOG_GPS_FIX_* type
+         * @param sats              Count of used satellites
+         * @param hdop              HDOP in 1/100
+         * @return                  TRUE if the fix is good
+         */
+        static bool isGoodFix(uint8_t fixType, uint8_t sats, uint16_t hdop);
+
+        /**
+         * Check is a position inside a circle. It use a equirectangular
+         * approximation with integer math, it is okay up to about 80°
+         * latitude.
+         *
+         * @param lat0              Center latitude in microdegrees
+         * @param lon0              Center longitude in microdegrees
+         * @param cosLat            cos of center latitude @see getCosLatitude
+         * @param lat               Latitude in microdegrees
+         * @param lon               Longitude in microdegrees
+         * @param radius            Radius in meters
+         * @return                  TRUE is inside
+         */
+        static bool isInRadius(int32_t lat0, int32_t lon0, uint16_t cosLat, int32_t lat, int32_t lon, uint16_t radius);
+
+        /**
+         * Parse a point "lat,lon" in decimal degrees with up to 6 digits
+         * after the point.
+         *
+         * @param str               String with point, need not end with '\0'
+         * @param size              Length of string
+         * @param lat               Latitude in microdegrees
+         * @param lon               Longitude in microdegrees
+         * @return                  TRUE if it is a valid point
+         */
+        static bool parseGeoPoint(const char *str, uint8_t size, int32_t *lat, int32_t *lon);
+
+        /**
+         * Parse a decimal degree value to microdegrees.
+         *
+         * @param str               String with value
+         * @param size              Length of string
+         * @param val               Value in microdegrees
+         * @return                  Count of char they are read or 0 for error
+         */
+        static uint8_t parseGeoValue(const char *str, uint8_t size, int32_t *val);
+
+        /**
+         * Convert a difference of microdegrees to meters.
          *
-         * @param a                 Latitude or Longitude
-         * @param b                 Latitude or Longitude
-         * @param geoFix            Acceptable geo corrections
-         * @return                  TRUE is equal
+         * @param diff              Difference in microdegrees
+         * @return                  Meters
          */
-        bool cmpGeoData(double a, double b, double geoFix);
+        static uint32_t toMeters(int32_t diff);
 };
 
 
@@ -0,0 +1,137 @@
+
+#include "GDPower.h"
+
+/** Watchdog wake up flag */
+static volatile bool s_wdtWake = false;
+
+/** Watchdog prescaler they can use for sleeping */
+static const uint16_t s_wdtTime[] PROGMEM = {
+    8000, 4000, 2000, 1000, 500, 250, 125, 64, 32, 16
+};
+
+static const uint8_t s_wdtBits[] PROGMEM = {
+    _BV(WDP3) | _BV(WDP0),
+    _BV(WDP3),
+    _BV(WDP2) | _BV(WDP1) | _BV(WDP0),
+    _BV(WDP2) | _BV(WDP1),
+    _BV(WDP2) | _BV(WDP0),
+    _BV(WDP2),
+    _BV(WDP1) | _BV(WDP0),
+    _BV(WDP1),
+    _BV(WDP0),
+    0x00
+};
+
+// weak, a ISR(WDT_vect) in the sketch replace it
+ISR(WDT_vect, __attribute__((weak)))
+{
+    GDPower::wakeWDT();
+}
+
+void GDPower::wakeWDT()
+{
+    s_wdtWake = true;
+}
+
+GDPower::GDPower()
+{
+    m_sleepOffset   ^= m_sleepOffset;
+    m_lastTime      ^= m_lastTime;
+    m_upSec         ^= m_upSec;
+    m_upRest        ^= m_upRest;
+    m_sleepSec      ^= m_sleepSec;
+    m_sleepRest     ^= m_sleepRest;
+}
+
+uint32_t GDPower::getTime()
+{
+    uint32_t now = millis() + m_sleepOffset;
+
+    ////
+    // count uptime
+    m_upRest    += static_cast<uint16_t>((now - m_lastTime) % 1000);
+    m_upSec     += (now - m_lastTime) / 1000;
+    m_lastTime  = now;
+
+    if (m_upRest >= 1000) {
+        m_upRest -= 1000;
+        m_upSec++;
+    }
+
+    return now;
+}
+
+bool GDPower::sleepFor(uint32_t ms)
+{
+    uint16_t wdtTime;
+    uint16_t slept;
+
+    // to short
+    if (ms < GPSDOG_POWER_MIN_SLEEP) {
+        return false;
+    }
+
+    // find the longest watchdog period
+    for (uint8_t i = 0; i < sizeof(s_wdtTime) / sizeof(uint16_t); i++) {
+        wdtTime = pgm_read_word(&s_wdtTime[i]);
+
+        if (wdtTime > ms) {
+            continue;
+        }
+
+        // sleep / a other interrupt wake up earlier, half is the best guess
+        slept = this->sleepWDT(pgm_read_byte(&s_wdtBits[i])) ? wdtTime : wdtTime / 2;
+
+        m_sleepOffset   += slept;
+        m_sleepRest     += slept;
+
+        while (m_sleepRest >= 1000) {
+            m_sleepRest -= 1000;
+            m_sleepSec++;
+        }
+
+        break;
+    }
+
+    return true;
+}
+
+bool GDPower::sleepWDT(uint8_t wdtBits)
+{
+    s_wdtWake = false;
+
+    ////
+    // start watchdog in interrupt mode
+    cli();
+    wdt_reset();
+    MCUSR   &= ~_BV(WDRF);
+    WDTCSR  = _BV(WDCE) | _BV(WDE);
+    WDTCSR  = _BV(WDIE) | wdtBits;
+
+    ////
+    // sleep
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+
+    // stop watchdog
+    wdt_disable();
+
+    return s_wdtWake;
+}
+
+uint32_t GDPower::getAwakeTime()
+{
+    this->getTime();
+
+    // all time without sleep
+    if (m_sleepSec > m_upSec) {
+        return 0;
+    }
+
+    return m_upSec - m_sleepSec;
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
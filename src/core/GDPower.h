@@ -0,0 +1,99 @@
+
+#ifndef GDPOWER_H
+#define GDPOWER_H
+
+// includes
+#include <Arduino.h>
+#include <inttypes.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <avr/interrupt.h>
+
+// config
+#define GPSDOG_POWER_MIN_SLEEP 16 // ms
+
+/**
+ * Object for low power idle and energy accounting.
+ *
+ * The MCU sleep in power-down mode and wake up with the watchdog timer.
+ * In power-down millis() stops, so the sleep time is add to a offset and
+ * @see getTime is the clock they include the sleep time. The watchdog
+ * oscillator is not very exact (+/- 10%).
+ *
+ * A other interrupt (like the modem ring indicator) can wake up the MCU
+ * in the middle of a watchdog period. The time they the MCU sleep is not
+ * known, so half of the period is counted.
+ */
+class GDPower
+{
+    private:
+
+        /** Sleep time in millis they correct millis() */
+        uint32_t    m_sleepOffset;
+
+        /** Last clock value for the uptime count */
+        uint32_t    m_lastTime;
+
+        /** Uptime in sec & rest in millis */
+        uint32_t    m_upSec;
+        uint16_t    m_upRest;
+
+        /** Sleep time in sec & rest in millis */
+        uint32_t    m_sleepSec;
+        uint16_t    m_sleepRest;
+
+        /**
+         * Sleep one watchdog period.
+         *
+         * @param wdtBits           Watchdog prescaler bits
+         * @return                  TRUE if watchdog wake up the MCU
+         */
+        bool sleepWDT(uint8_t wdtBits);
+
+    public:
+
+        GDPower();
+
+        /**
+         * Mark the sleep as done by the watchdog. It is call from the
+         * watchdog ISR of the library. It is weak, a sketch with a own
+         * ISR(WDT_vect) replace it and need to call this from there.
+         */
+        static void wakeWDT();
+
+        /**
+         * Get millis value with the time they the MCU sleep.
+         *
+         * @return                  Corrected millis value
+         */
+        uint32_t getTime();
+
+        /**
+         * Sleep in power-down mode max the given time. Other interrupts
+         * can wake up the MCU earlier.
+         *
+         * @param ms                Max millis to sleep
+         * @return                  FALSE if time is to short for sleeping
+         */
+        bool sleepFor(uint32_t ms);
+
+        /**
+         * Get the time they the MCU is awake since boot.
+         *
+         * @return                  Awake time in sec
+         */
+        uint32_t getAwakeTime();
+
+        /**
+         * Get the time they the MCU sleep since boot.
+         *
+         * @return                  Sleep time in sec
+         */
+        uint32_t getSleepTime() {
+            return m_sleepSec;
+        }
+};
+
+#endif
+
+// vim: set sts=4 sw=4 ts=4 et:
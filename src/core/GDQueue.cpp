@@ -0,0 +1,154 @@
+
+#include "GDQueue.h"
+
+GDQueue::GDQueue()
+{
+    memset(m_queue, 0x00, sizeof(m_queue));
+
+    m_queueHead     ^= m_queueHead;
+    m_queueCount    ^= m_queueCount;
+}
+
+bool GDQueue::pushQueue(uint8_t numberIdx, uint8_t kind, uint8_t payload, bool alarm, uint32_t now)
+{
+    GD_QUEUE_ENTRY *entry;
+
+    ////
+    // Same message is allready in queue
+    for (uint8_t i = 0; i < m_queueCount; i++) {
+        entry = this->getQueueEntry(i);
+
+        if (entry->m_numberIdx == numberIdx && entry->m_kind == kind && entry->m_payload == payload) {
+            // it is a new message, start the retries new
+            entry->m_retry  = 0;
+            entry->m_alarm  |= alarm;
+
+            if (static_cast<int32_t>(entry->m_nextTry - now) > GPSDOG_QUEUE_BACKOFF) {
+                entry->m_nextTry = now + GPSDOG_QUEUE_BACKOFF;
+            }
+
+            return true;
+        }
+    }
+
+    ////
+    // Queue is full
+    if (m_queueCount >= GPSDOG_QUEUE_SIZE) {
+        // command reply can't replace other
+        if (!alarm) {
+            return false;
+        }
+
+        // replace the oldest command reply
+        for (uint8_t i = 0; i < m_queueCount; i++) {
+            if (!this->getQueueEntry(i)->m_alarm) {
+                this->removeQueuePos(i);
+                break;
+            }
+        }
+
+        // all are alarms
+        if (m_queueCount >= GPSDOG_QUEUE_SIZE) {
+            return false;
+        }
+    }
+
+    ////
+    // Add to end of ring
+    entry = this->getQueueEntry(m_queueCount++);
+
+    entry->m_nextTry    = now + GPSDOG_QUEUE_BACKOFF;
+    entry->m_numberIdx  = numberIdx;
+    entry->m_kind       = kind;
+    entry->m_payload    = payload;
+    entry->m_retry      = 0;
+    entry->m_alarm      = alarm;
+
+    return true;
+}
+
+uint8_t GDQueue::getQueueNext(uint32_t now)
+{
+    uint8_t         pos = GPSDOG_QUEUE_NONE;
+    GD_QUEUE_ENTRY  *entry;
+
+    for (uint8_t i = 0; i < m_queueCount; i++) {
+        entry = this->getQueueEntry(i);
+
+        // wait
+        if (static_cast<int32_t>(now - entry->m_nextTry) < 0) {
+            continue;
+        }
+
+        // alarm first
+        if (entry->m_alarm) {
+            return i;
+        }
+        else if (pos == GPSDOG_QUEUE_NONE) {
+            pos = i;
+        }
+    }
+
+    return pos;
+}
+
+bool GDQueue::failQueue(uint8_t pos, uint32_t now)
+{
+    GD_QUEUE_ENTRY *entry = this->getQueueEntry(pos);
+
+    // give up
+    if (++entry->m_retry >= GPSDOG_QUEUE_RETRY) {
+        this->removeQueuePos(pos);
+        return false;
+    }
+
+    // backoff
+    entry->m_nextTry = now + (static_cast<uint32_t>(GPSDOG_QUEUE_BACKOFF) << entry->m_retry);
+
+    return true;
+}
+
+uint32_t GDQueue::getQueueWait(uint32_t now)
+{
+    uint32_t    wait = 0xFFFFFFFF;
+    int32_t     diff;
+
+    for (uint8_t i = 0; i < m_queueCount; i++) {
+        diff = static_cast<int32_t>(this->getQueueEntry(i)->m_nextTry - now);
+
+        // is due
+        if (diff <= 0) {
+            return 0;
+        }
+
+        if (static_cast<uint32_t>(diff) < wait) {
+            wait = diff;
+        }
+    }
+
+    return wait;
+}
+
+void GDQueue::removeQueuePos(uint8_t pos)
+{
+    // index secure
+    if (pos >= m_queueCount) {
+        return;
+    }
+
+    // first entry
+    if (pos == 0) {
+        m_queueHead = (m_queueHead + 1) % GPSDOG_QUEUE_SIZE;
+        m_queueCount--;
+        return;
+    }
+
+    // close the gap
+    for (uint8_t i = pos; i < m_queueCount -1; i++) {
+        *this->getQueueEntry(i) = *this->getQueueEntry(i +1);
+    }
+
+    m_queueCount--;
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
@@ -0,0 +1,137 @@
+
+#ifndef GDQUEUE_H
+#define GDQUEUE_H
+
+// includes
+#include <inttypes.h>
+#include <string.h>
+
+// config
+#define GPSDOG_QUEUE_SIZE 0x08
+#define GPSDOG_QUEUE_RETRY 0x05
+#define GPSDOG_QUEUE_BACKOFF 30000 // 30sec, double on every retry
+#define GPSDOG_QUEUE_NONE 0xFF
+
+/**
+ * Outbound SMS they wait for a retry
+ */
+struct GD_QUEUE_ENTRY
+{
+    /** Millis value for the next try */
+    uint32_t    m_nextTry;
+
+    /** Index of number in store */
+    uint8_t     m_numberIdx;
+
+    /** Kind of message they will be generate on send */
+    uint8_t     m_kind;
+
+    /** Option for the message kind */
+    uint8_t     m_payload;
+
+    /** Count of failed tries */
+    uint8_t     m_retry : 7;
+
+    /** Alarm messages have priority */
+    uint8_t     m_alarm : 1;
+};
+
+/**
+ * Object for a ring buffer of outbound SMS with retry and backoff.
+ * The message text is not stored, it will be generate from kind and
+ * payload on every try.
+ */
+class GDQueue
+{
+    private:
+
+        /** Queue store */
+        GD_QUEUE_ENTRY  m_queue[GPSDOG_QUEUE_SIZE];
+
+        /** First entry in ring */
+        uint8_t         m_queueHead;
+
+        /** Count of entries in ring */
+        uint8_t         m_queueCount;
+
+        /**
+         * Remove a entry from ring and close the gap.
+         *
+         * @param pos           Position in ring
+         */
+        void removeQueuePos(uint8_t pos);
+
+    public:
+
+        GDQueue();
+
+        /**
+         * Add a message to queue. If the queue is full, a alarm message
+         * replace the oldest command reply. A message they is allready in
+         * queue start the retries new.
+         *
+         * @param numberIdx     Index of number in store
+         * @param kind          Kind of message
+         * @param payload       Option for kind
+         * @param alarm         TRUE for alarm priority
+         * @param now           Actual millis value
+         * @return              FALSE if queue is full
+         */
+        bool pushQueue(uint8_t numberIdx, uint8_t kind, uint8_t payload, bool alarm, uint32_t now);
+
+        /**
+         * Get the next message they is due. Alarm messages come first.
+         *
+         * @param now           Actual millis value
+         * @return              Position in ring or GPSDOG_QUEUE_NONE
+         */
+        uint8_t getQueueNext(uint32_t now);
+
+        /**
+         * Get a entry of queue.
+         *
+         * @param pos           Position from @see getQueueNext
+         * @return              Pointer to entry
+         */
+        GD_QUEUE_ENTRY* getQueueEntry(uint8_t pos) {
+            return &m_queue[(m_queueHead + pos) % GPSDOG_QUEUE_SIZE];
+        }
+
+        /**
+         * Mark a entry as send and remove it.
+         *
+         * @param pos           Position from @see getQueueNext
+         */
+        void doneQueue(uint8_t pos) {
+            this->removeQueuePos(pos);
+        }
+
+        /**
+         * Mark a entry as failed. It will be retry with backoff or remove
+         * after GPSDOG_QUEUE_RETRY.
+         *
+         * @param pos           Position from @see getQueueNext
+         * @param now           Actual millis value
+         * @return              FALSE if the entry is removed
+         */
+        bool failQueue(uint8_t pos, uint32_t now);
+
+        /**
+         * Get millis until the next entry is due.
+         *
+         * @param now           Actual millis value
+         * @return              Millis to wait or 0
+         */
+        uint32_t getQueueWait(uint32_t now);
+
+        /**
+         * Count of messages in queue.
+         */
+        uint8_t getQueueCount() {
+            return m_queueCount;
+        }
+};
+
+#endif
+
+// vim: set sts=4 sw=4 ts=4 et:
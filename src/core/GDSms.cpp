@@ -9,6 +9,7 @@ GDSms::GDSms()
     m_numberSize        ^= m_numberSize;
     m_messageSize       ^= m_messageSize;
     m_lastParamCount    ^= m_lastParamCount;
+    m_tokenCount        ^= m_tokenCount;
 }
 
 bool GDSms::isReady()
@@ -45,9 +46,41 @@ bool GDSms::setNumber(char *number)
     return true;
 }
 
+bool GDSms::peekSMSCommand(PGM_P cmd)
+{
+    uint8_t i       = 0;
+    uint8_t size    = strlen_P(cmd);
+
+    // buffer is set
+    if (m_message == NULL) {
+        return false;
+    }
+
+    // skip leading whitespace
+    while (i < m_messageSize && m_message[i] != 0x00 && isspace(m_message[i])) {
+        i++;
+    }
+
+    // to short or other command
+    if (i + size > m_messageSize || strncasecmp_P(&m_message[i], cmd, size) != 0) {
+        return false;
+    }
+
+    // end of first word
+    if (i + size == m_messageSize || m_message[i + size] == 0x00 || isspace(m_message[i + size])) {
+        return true;
+    }
+
+    return false;
+}
+
 uint8_t GDSms::parseSMSMessage()
 {
-    m_lastParamCount = 0;
+    uint8_t count   = 0;
+    bool    inToken = false;
+
+    m_lastParamCount    = 0;
+    m_tokenCount        = 0;
 
     // buffer is set
     if (m_message == NULL) {
@@ -55,67 +88,91 @@ uint8_t GDSms::parseSMSMessage()
     }
 
     // search hole string
-    for (uint8_t i = 0; i < m_messageSize; i++) {
+    for (uint8_t i = 0; i < m_messageSize && m_message[i] != 0x00; i++) {
 
-        // end
-        if (m_message[i] == 0x00) {
-            return m_lastParamCount;
+        // whitespace
+        if (isspace(m_message[i])) {
+            inToken = false;
         }
-        // ' ' replace with '\0'
-        else if (m_message[i] == 0x20) {
-            m_message[i] = 0x00;
+        // new element
+        else if (!inToken) {
+            inToken = true;
+
+            if (count < GPSDOG_SMS_MAX_TOKEN) {
+                m_tokenPos[count] = i;
+                m_tokenLen[count] = 0;
+            }
+
+            count++;
         }
 
-        // count
-        if (i > 0 && m_message[i] == 0x00 && m_message[i-1] != 0x00) {
-            m_lastParamCount++;
+        // length
+        if (inToken && count <= GPSDOG_SMS_MAX_TOKEN) {
+            m_tokenLen[count -1]++;
         }
     }
 
+    // save count
+    if (count > GPSDOG_SMS_MAX_TOKEN) {
+        m_tokenCount = GPSDOG_SMS_MAX_TOKEN;
+    }
+    else {
+        m_tokenCount = count;
+    }
+
+    // without command
+    if (count > 0) {
+        m_lastParamCount = count -1;
+    }
+
     return m_lastParamCount;
 }
 
 char* GDSms::getParseElement(uint8_t idx)
 {
-    uint8_t count = 0;
-
-    // buffer is set
-    if (m_message == NULL) {
+    // buffer is set & element exists
+    if (m_message == NULL || idx >= m_tokenCount) {
         return NULL;
     }
 
-    // search hole string
-    for (uint8_t i = 0; i < m_messageSize; i++) {
-
-        // find next position
-        if (m_message[i] == 0x00 && i > 0 && m_message[i-1] != 0x00) {
-            count++;
-        }
+    return &m_message[m_tokenPos[idx]];
+}
 
-        // found indx with next character
-        if (count == idx && m_message[i] != 0x00) {
-            return &m_message[i];
-        }
+uint8_t GDSms::getParseElementSize(uint8_t idx)
+{
+    // element exists
+    if (idx >= m_tokenCount) {
+        return 0;
     }
 
-    return NULL;
+    return m_tokenLen[idx];
 }
 
-char* GDSms::getParseElementUpper(uint8_t idx)
+bool GDSms::cmpParseElement(uint8_t idx, PGM_P txt)
 {
-    char *element = this->getParseElement(idx);
+    // element exists & same size
+    if (idx >= m_tokenCount || m_tokenLen[idx] != strlen_P(txt)) {
+        return false;
+    }
 
-    // not found?
-    if (element == NULL) {
-        return NULL;
+    if (strncasecmp_P(&m_message[m_tokenPos[idx]], txt, m_tokenLen[idx]) == 0) {
+        return true;
     }
 
-    for (uint8_t i = 0; element[i] != 0x00; i++) {
-        // set upper
-        element[i] = toupper(element[i]);
+    return false;
+}
+
+bool GDSms::copyParseElement(uint8_t idx, char *buffer, uint8_t size)
+{
+    // element exists & buffer size is okay
+    if (idx >= m_tokenCount || m_tokenLen[idx] >= size) {
+        return false;
     }
 
-    return element;
+    memset(buffer, 0x00, size);
+    memcpy(buffer, &m_message[m_tokenPos[idx]], m_tokenLen[idx]);
+
+    return true;
 }
 
 // vim: set sts=4 sw=4 ts=4 et:
@@ -6,12 +6,27 @@
 #include <inttypes.h>
 #include <string.h>
 #include <ctype.h>
+#include <avr/pgmspace.h>
+
+// config
+#define GPSDOG_SMS_MAX_TOKEN 0x0A
 
 /**
  * Object for process sms data
  */
 class GDSms
 {
+    private:
+
+        /** Offset of parsed elements in message */
+        uint8_t m_tokenPos[GPSDOG_SMS_MAX_TOKEN];
+
+        /** Length of parsed elements */
+        uint8_t m_tokenLen[GPSDOG_SMS_MAX_TOKEN];
+
+        /** Count of elements in @see m_tokenPos */
+        uint8_t m_tokenCount;
+
     public:
 
         GDSms();
@@ -53,42 +68,65 @@ class GDSms
          */
         bool isReady();
 
+        /**
+         * Check the first word of the unparsed message without change
+         * the buffer. Compare is case insensitive.
+         *
+         * @param cmd           Command in PROGMEM
+         * @return              TRUE if the message start with command
+         */
+        bool peekSMSCommand(PGM_P cmd);
+
         /**
          * Parse message for internal processing.
-         * It work like strtok with ' '. Set also the first element to
-         * uppercase. This is the command to GPSDog.
+         * It work like strtok with whitespaces in one pass and store the
+         * offset of every element. The message buffer is not changed, so
+         * it can forward as it is. The first element is the command to
+         * GPSDog.
          *
-         * @return              Count of parsed elements
+         * @return              Count of parsed elements without command
          */
         uint8_t parseSMSMessage();
 
         /**
-         * Get a element of the parsed message.
+         * Get a element of the parsed message. The element is not '\0'
+         * terminated, it end with a whitespace or the end of message.
          * @see parseSMSMessage();
          *
          * @param idx           The element they will have
-         * @return              A pointer to this element in message
+         * @return              A pointer to this element in message or NULL
          */
         char* getParseElement(uint8_t idx);
 
         /**
-         * Get a element of the parsed message as Uppercase.
+         * Get the length of a parsed element.
          * @see parseSMSMessage();
          *
          * @param idx           The element they will have
-         * @return              A pointer to element or NULL
+         * @return              Length of element or 0
          */
-        char* getParseElementUpper(uint8_t idx);
+        uint8_t getParseElementSize(uint8_t idx);
 
         /**
-         * Extract GPSDog command from message.
-         * Use first @see parseSMSMessage!
+         * Compare a parsed element case insensitive with a text.
+         * @see parseSMSMessage();
+         *
+         * @param idx           The element they will compare
+         * @param txt           Text in PROGMEM
+         * @return              TRUE if the element is equal
+         */
+        bool cmpParseElement(uint8_t idx, PGM_P txt);
+
+        /**
+         * Copy a parsed element as string to a buffer.
+         * @see parseSMSMessage();
          *
-         * @return              The parsed GPSDog SMS command
+         * @param idx           The element they will copy
+         * @param buffer        Buffer for the element
+         * @param size          Size of buffer
+         * @return              FALSE if element not exists or to long
          */
-        char* getSMSCommand() {
-            return getParseElementUpper(0);
-        }
+        bool copyParseElement(uint8_t idx, char *buffer, uint8_t size);
 };
 
 #endif
@@ -0,0 +1,87 @@
+
+#include "GDSnap.h"
+
+// snapshot slots need to fit into EEPROM
+static_assert(GPSDOG_SNAP_START + GPSDOG_SNAP_SLOTS * sizeof(GD_SNAP) <= E2END + 1, "Snapshot slots are to big for EEPROM");
+
+GDSnap::GDSnap()
+{
+    memset(&m_snap, 0x00, sizeof(GD_SNAP));
+
+    // next write go to first slot
+    m_snapSlot = GPSDOG_SNAP_SLOTS -1;
+}
+
+uint8_t GDSnap::crcSnap(GD_SNAP *snap)
+{
+    uint8_t *p  = reinterpret_cast<uint8_t*>(snap);
+    uint8_t crc = 0x00;
+
+    for (uint8_t i = 0; i < offsetof(GD_SNAP, m_crc); i++) {
+        crc = _crc8_ccitt_update(crc, p[i]);
+    }
+
+    return crc;
+}
+
+bool GDSnap::loadSnap()
+{
+    GD_SNAP     snap;
+    uint8_t     *p      = reinterpret_cast<uint8_t*>(&snap);
+    uint16_t    addr;
+    bool        found   = false;
+
+    for (uint8_t i = 0; i < GPSDOG_SNAP_SLOTS; i++) {
+        addr = GPSDOG_SNAP_START + i * sizeof(GD_SNAP);
+
+        for (uint8_t y = 0; y < sizeof(GD_SNAP); y++) {
+            p[y] = EEPROM.read(addr + y);
+        }
+
+        // empty or broken
+        if (snap.m_flags == 0x00 || snap.m_crc != crcSnap(&snap)) {
+            continue;
+        }
+
+        // newest (rollover safe)
+        if (!found || static_cast<int8_t>(snap.m_seq - m_snap.m_seq) > 0) {
+            memcpy(&m_snap, &snap, sizeof(GD_SNAP));
+            m_snapSlot  = i;
+            found       = true;
+        }
+    }
+
+    return found;
+}
+
+void GDSnap::writeSnap(uint8_t flags, int32_t lat, int32_t lon, uint16_t alarmLeft)
+{
+    uint8_t     *p = reinterpret_cast<uint8_t*>(&m_snap);
+    uint16_t    addr;
+
+    m_snap.m_seq++;
+    m_snap.m_flags      = flags;
+    m_snap.m_latitude   = lat;
+    m_snap.m_longitude  = lon;
+    m_snap.m_alarmLeft  = alarmLeft;
+    m_snap.m_crc        = crcSnap(&m_snap);
+
+    // next slot
+    m_snapSlot  = (m_snapSlot + 1) % GPSDOG_SNAP_SLOTS;
+    addr        = GPSDOG_SNAP_START + m_snapSlot * sizeof(GD_SNAP);
+
+    for (uint8_t i = 0; i < sizeof(GD_SNAP); i++) {
+        EEPROM.update(addr + i, p[i]);
+    }
+}
+
+void GDSnap::cleanSnap()
+{
+    for (uint8_t i = 0; i < GPSDOG_SNAP_SLOTS; i++) {
+        EEPROM.update(GPSDOG_SNAP_START + i * sizeof(GD_SNAP) + offsetof(GD_SNAP, m_flags), 0x00);
+    }
+
+    memset(&m_snap, 0x00, sizeof(GD_SNAP));
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
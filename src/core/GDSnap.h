@@ -0,0 +1,105 @@
+
+#ifndef GDSNAP_H
+#define GDSNAP_H
+
+// includes
+#include <EEPROM.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stddef.h>
+#include <util/crc16.h>
+
+#include "GDFence.h"
+
+// config
+#define GPSDOG_SNAP_SLOTS 0x04
+
+// EEPROM snapshot slots after the zone store
+#define GPSDOG_SNAP_START (GPSDOG_FENCE_START + GPSDOG_FENCE_COUNT * sizeof(GD_FENCE_ZONE))
+
+// snapshot flags
+#define GPSDOG_SNAP_FIX 0x01
+#define GPSDOG_SNAP_ALARM 0x02
+
+/**
+ * Runtime snapshot in EEPROM
+ */
+struct GD_SNAP
+{
+    /** Sequence, the newest slot is valid */
+    uint8_t     m_seq;
+
+    /** GPSDOG_SNAP_* flags */
+    uint8_t     m_flags;
+
+    /** Last good fix in microdegrees */
+    int32_t     m_latitude;
+    int32_t     m_longitude;
+
+    /** Seconds until next alarm SMS */
+    uint16_t    m_alarmLeft;
+
+    /** CRC8 over all data before */
+    uint8_t     m_crc;
+};
+
+/**
+ * Object for the runtime state they should survive a reset. It is not
+ * a part of the config, so it use own slots in EEPROM. Every write go
+ * to the next slot for wear leveling.
+ */
+class GDSnap
+{
+    private:
+
+        /** Last valid snapshot */
+        GD_SNAP     m_snap;
+
+        /** Slot of last snapshot */
+        uint8_t     m_snapSlot;
+
+        /**
+         * Calc CRC8 over a snapshot.
+         *
+         * @param snap              Snapshot
+         * @return                  CRC8 value
+         */
+        static uint8_t crcSnap(GD_SNAP *snap);
+
+    public:
+
+        GDSnap();
+
+        /**
+         * Read the newest valid snapshot from EEPROM.
+         *
+         * @return                  TRUE if a snapshot is found
+         */
+        bool loadSnap();
+
+        /**
+         * Write a snapshot to the next slot.
+         *
+         * @param flags             GPSDOG_SNAP_* flags
+         * @param lat               Latitude in microdegrees
+         * @param lon               Longitude in microdegrees
+         * @param alarmLeft         Seconds until next alarm SMS
+         */
+        void writeSnap(uint8_t flags, int32_t lat, int32_t lon, uint16_t alarmLeft);
+
+        /**
+         * Invalid all slots.
+         */
+        void cleanSnap();
+
+        /**
+         * Getter for last snapshot. Flags are 0 if nothing is found.
+         */
+        GD_SNAP* getSnap() {
+            return &m_snap;
+        }
+};
+
+#endif
+
+// vim: set sts=4 sw=4 ts=4 et:
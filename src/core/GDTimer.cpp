@@ -0,0 +1,105 @@
+
+#include "GDTimer.h"
+
+GDTimer::GDTimer()
+{
+    memset(m_timers, 0x00, sizeof(m_timers));
+}
+
+void GDTimer::startTimer(uint8_t id, uint32_t now, uint32_t wait, uint32_t period)
+{
+    // index secure
+    if (id >= GPSDOG_TIMER_COUNT) {
+        return;
+    }
+
+    m_timers[id].m_deadline = now + wait;
+    m_timers[id].m_period   = period;
+    m_timers[id].m_active   = true;
+}
+
+void GDTimer::stopTimer(uint8_t id)
+{
+    // index secure
+    if (id >= GPSDOG_TIMER_COUNT) {
+        return;
+    }
+
+    m_timers[id].m_active = false;
+}
+
+bool GDTimer::isTimerActive(uint8_t id)
+{
+    // index secure
+    if (id >= GPSDOG_TIMER_COUNT) {
+        return false;
+    }
+
+    return m_timers[id].m_active;
+}
+
+bool GDTimer::isTimerDue(uint8_t id, uint32_t now)
+{
+    GD_TIMER *timer;
+
+    // index secure
+    if (id >= GPSDOG_TIMER_COUNT) {
+        return false;
+    }
+
+    timer = &m_timers[id];
+
+    // not running or wait
+    if (!timer->m_active || !isReached(timer->m_deadline, now)) {
+        return false;
+    }
+
+    ////
+    // Restart periodic timer
+    if (timer->m_period > 0) {
+        timer->m_deadline += timer->m_period;
+
+        // we lost some periods
+        if (isReached(timer->m_deadline, now)) {
+            timer->m_deadline = now + timer->m_period;
+        }
+    }
+    // one-shot
+    else {
+        timer->m_active = false;
+    }
+
+    return true;
+}
+
+uint32_t GDTimer::getTimeLeft(uint8_t id, uint32_t now)
+{
+    // index secure & running
+    if (id >= GPSDOG_TIMER_COUNT || !m_timers[id].m_active) {
+        return 0;
+    }
+
+    // expired
+    if (isReached(m_timers[id].m_deadline, now)) {
+        return 0;
+    }
+
+    return m_timers[id].m_deadline - now;
+}
+
+uint32_t GDTimer::getNextDeadline(uint32_t now, uint32_t maxWait)
+{
+    uint32_t next = now + maxWait;
+
+    // search the earliest deadline
+    for (uint8_t i = 0; i < GPSDOG_TIMER_COUNT; i++) {
+
+        if (m_timers[i].m_active && isReached(m_timers[i].m_deadline, next)) {
+            next = m_timers[i].m_deadline;
+        }
+    }
+
+    return next;
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
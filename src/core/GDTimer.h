@@ -0,0 +1,109 @@
+
+#ifndef GDTIMER_H
+#define GDTIMER_H
+
+// includes
+#include <inttypes.h>
+#include <string.h>
+
+// config
+#define GPSDOG_TIMER_COUNT 0x06
+
+/**
+ * A millis deadline with optional period
+ */
+struct GD_TIMER
+{
+    /** Millis value they the timer expire */
+    uint32_t    m_deadline;
+
+    /** Period for restart the timer / 0 is one-shot */
+    uint32_t    m_period;
+
+    /** Timer is running */
+    bool        m_active;
+};
+
+/**
+ * Object for deadline handling. All compares are safe for a millis()
+ * overflow as long as a delay is shorter than 24 days.
+ */
+class GDTimer
+{
+    private:
+
+        /** Timer store */
+        GD_TIMER    m_timers[GPSDOG_TIMER_COUNT];
+
+    public:
+
+        GDTimer();
+
+        /**
+         * Check is a deadline reached.
+         *
+         * @param deadline          Millis value of deadline
+         * @param now               Actual millis value
+         * @return                  TRUE if deadline is reached
+         */
+        static bool isReached(uint32_t deadline, uint32_t now) {
+            return static_cast<int32_t>(now - deadline) >= 0;
+        }
+
+        /**
+         * Start or restart a timer.
+         *
+         * @param id                Index of timer
+         * @param now               Actual millis value
+         * @param wait              Millis until the timer expire
+         * @param period            Millis for periodic restart or 0
+         */
+        void startTimer(uint8_t id, uint32_t now, uint32_t wait, uint32_t period);
+
+        /**
+         * Stop a timer.
+         *
+         * @param id                Index of timer
+         */
+        void stopTimer(uint8_t id);
+
+        /**
+         * Check is a timer running.
+         *
+         * @param id                Index of timer
+         * @return                  TRUE if timer is active
+         */
+        bool isTimerActive(uint8_t id);
+
+        /**
+         * Check is a timer expired. A one-shot timer will be stopped and
+         * a periodic timer restart with his period.
+         *
+         * @param id                Index of timer
+         * @param now               Actual millis value
+         * @return                  TRUE if timer is expired
+         */
+        bool isTimerDue(uint8_t id, uint32_t now);
+
+        /**
+         * Get the millis until timer expire.
+         *
+         * @param id                Index of timer
+         * @param now               Actual millis value
+         * @return                  Millis they left or 0
+         */
+        uint32_t getTimeLeft(uint8_t id, uint32_t now);
+
+        /**
+         * Get the earliest deadline of all running timer.
+         *
+         * @param now               Actual millis value
+         * @param maxWait           Max millis to wait if no timer is running
+         * @return                  Millis value of next deadline
+         */
+        uint32_t getNextDeadline(uint32_t now, uint32_t maxWait);
+};
+
+#endif
+
+// vim: set sts=4 sw=4 ts=4 et:
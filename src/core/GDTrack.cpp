@@ -0,0 +1,408 @@
+
+#include "GDTrack.h"
+
+// ring buffer position is uint8_t / spill area need space for a record
+static_assert(GPSDOG_TRACK_SIZE <= 0xFF, "Track buffer is to big");
+static_assert(GPSDOG_TRACK_START + GPSDOG_TRACK_HEADER + GPSDOG_TRACK_RECORD < E2END + 1, "No EEPROM space for track");
+
+GDTrack::GDTrack()
+{
+    m_trackStart        ^= m_trackStart;
+    m_trackLen          ^= m_trackLen;
+    m_trackCount        ^= m_trackCount;
+    m_trackWindowCount  ^= m_trackWindowCount;
+    m_trackChanged      = false;
+}
+
+void GDTrack::cleanTrack()
+{
+    m_trackStart        ^= m_trackStart;
+    m_trackLen          ^= m_trackLen;
+    m_trackCount        ^= m_trackCount;
+    m_trackWindowCount  ^= m_trackWindowCount;
+    m_trackChanged      = false;
+
+    // invalidate EEPROM
+    EEPROM.update(GPSDOG_TRACK_START, 0x00);
+}
+
+uint8_t GDTrack::writeVarint(uint8_t *buffer, uint32_t val)
+{
+    uint8_t len = 0;
+
+    // 7 bit per byte, bit 7 is set if more follow
+    while (val > 0x7F) {
+        buffer[len++]   = (val & 0x7F) | 0x80;
+        val             >>= 7;
+    }
+
+    buffer[len++] = val;
+
+    return len;
+}
+
+uint8_t GDTrack::readVarint(uint8_t pos, uint32_t *val)
+{
+    uint8_t len = 0;
+    uint8_t data;
+
+    *val ^= *val;
+
+    do {
+        data    = m_track[(static_cast<uint16_t>(m_trackStart) + pos + len) % GPSDOG_TRACK_SIZE];
+        *val    |= static_cast<uint32_t>(data & 0x7F) << (7 * len);
+        len++;
+    } while ((data & 0x80) && len < 5);
+
+    return len;
+}
+
+uint8_t GDTrack::readRecord(uint8_t pos, GD_TRACK_POINT *point)
+{
+    uint32_t    val;
+    uint8_t     len;
+
+    len = this->readVarint(pos, &val);
+    point->m_latitude   += fromZigzag(val);
+
+    len += this->readVarint(pos + len, &val);
+    point->m_longitude  += fromZigzag(val);
+
+    len += this->readVarint(pos + len, &val);
+    point->m_time       += val;
+
+    return len;
+}
+
+void GDTrack::dropTrack()
+{
+    uint8_t len;
+
+    // only tail
+    if (m_trackLen == 0) {
+        m_trackCount ^= m_trackCount;
+        return;
+    }
+
+    // next point is the new tail
+    len = this->readRecord(0, &m_trackTail);
+
+    m_trackStart    = (static_cast<uint16_t>(m_trackStart) + len) % GPSDOG_TRACK_SIZE;
+    m_trackLen      -= len;
+    m_trackCount--;
+}
+
+void GDTrack::pushTrack(GD_TRACK_POINT *point)
+{
+    uint8_t record[GPSDOG_TRACK_RECORD];
+    uint8_t len;
+
+    ////
+    // First point
+    if (m_trackCount == 0) {
+        memcpy(&m_trackTail, point, sizeof(GD_TRACK_POINT));
+
+        m_trackStart    ^= m_trackStart;
+        m_trackLen      ^= m_trackLen;
+        m_trackCount    = 1;
+    }
+    ////
+    // Record with delta to newest point
+    else {
+        len = writeVarint(record, toZigzag(point->m_latitude - m_trackHead.m_latitude));
+        len += writeVarint(record + len, toZigzag(point->m_longitude - m_trackHead.m_longitude));
+        len += writeVarint(record + len, point->m_time - m_trackHead.m_time);
+
+        // free space
+        while (GPSDOG_TRACK_SIZE - m_trackLen < len) {
+            this->dropTrack();
+        }
+
+        for (uint8_t i = 0; i < len; i++) {
+            m_track[(static_cast<uint16_t>(m_trackStart) + m_trackLen + i) % GPSDOG_TRACK_SIZE] = record[i];
+        }
+
+        m_trackLen += len;
+        m_trackCount++;
+    }
+
+    memcpy(&m_trackHead, point, sizeof(GD_TRACK_POINT));
+    m_trackCos = GDGps::getCosLatitude(point->m_latitude * GPSDOG_TRACK_QUANT);
+}
+
+void GDTrack::flushTrack()
+{
+    if (m_trackWindowCount > 0) {
+        this->pushTrack(&m_trackWindow[m_trackWindowCount -1]);
+        m_trackWindowCount ^= m_trackWindowCount;
+    }
+}
+
+bool GDTrack::isInTolerance(GD_TRACK_POINT *end)
+{
+    // tolerance in track units
+    int64_t tol = (static_cast<int32_t>(GPSDOG_TRACK_TOLERANCE) << 14) / (GPSDOG_GPS_METER_MUL * GPSDOG_TRACK_QUANT);
+    int64_t ex;
+    int64_t ey;
+    int64_t px;
+    int64_t py;
+    int64_t len;
+    int64_t dot;
+    int64_t cross;
+
+    // line from newest stored point, x is scaled with cos
+    ex  = (static_cast<int64_t>(end->m_longitude - m_trackHead.m_longitude) * m_trackCos) >> 14;
+    ey  = end->m_latitude - m_trackHead.m_latitude;
+    len = ex * ex + ey * ey;
+
+    // a long line is not simplified (overflow secure)
+    if (ex > GPSDOG_TRACK_LINE_MAX || ex < -GPSDOG_TRACK_LINE_MAX || ey > GPSDOG_TRACK_LINE_MAX || ey < -GPSDOG_TRACK_LINE_MAX) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < m_trackWindowCount; i++) {
+        px  = (static_cast<int64_t>(m_trackWindow[i].m_longitude - m_trackHead.m_longitude) * m_trackCos) >> 14;
+        py  = m_trackWindow[i].m_latitude - m_trackHead.m_latitude;
+
+        if (px > GPSDOG_TRACK_LINE_MAX || px < -GPSDOG_TRACK_LINE_MAX || py > GPSDOG_TRACK_LINE_MAX || py < -GPSDOG_TRACK_LINE_MAX) {
+            return false;
+        }
+
+        dot = px * ex + py * ey;
+
+        // after end of line, distance to end
+        if (dot >= len) {
+            px -= ex;
+            py -= ey;
+        }
+
+        // beside the line, distance is cross / |line|
+        if (dot > 0 && dot < len) {
+            cross = px * ey - py * ex;
+
+            if (cross * cross > tol * tol * len) {
+                return false;
+            }
+        }
+        // distance to start or end
+        else if (px * px + py * py > tol * tol) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void GDTrack::addTrack(int32_t lat, int32_t lon, uint32_t time)
+{
+    GD_TRACK_POINT  point;
+    GD_TRACK_POINT  *last   = m_trackWindowCount > 0 ? &m_trackWindow[m_trackWindowCount -1] : &m_trackHead;
+
+    // to track units with rounding
+    point.m_latitude    = (lat < 0 ? lat - GPSDOG_TRACK_QUANT / 2 : lat + GPSDOG_TRACK_QUANT / 2) / GPSDOG_TRACK_QUANT;
+    point.m_longitude   = (lon < 0 ? lon - GPSDOG_TRACK_QUANT / 2 : lon + GPSDOG_TRACK_QUANT / 2) / GPSDOG_TRACK_QUANT;
+    point.m_time        = time;
+
+    // first point
+    if (m_trackCount == 0) {
+        this->pushTrack(&point);
+        m_trackChanged = true;
+        return;
+    }
+
+    // near the newest point
+    if (GDGps::toMeters((point.m_latitude - last->m_latitude) * GPSDOG_TRACK_QUANT) < GPSDOG_TRACK_MOVE &&
+        GDGps::toMeters((point.m_longitude - last->m_longitude) * GPSDOG_TRACK_QUANT) < GPSDOG_TRACK_MOVE) {
+        return;
+    }
+
+    m_trackChanged = true;
+
+    ////
+    // Simplification / store the point before if the line is not okay
+    if (GPSDOG_TRACK_TOLERANCE == 0 || m_trackWindowCount == GPSDOG_TRACK_WINDOW || !this->isInTolerance(&point)) {
+        this->flushTrack();
+    }
+
+    memcpy(&m_trackWindow[m_trackWindowCount++], &point, sizeof(GD_TRACK_POINT));
+
+    // no simplification
+    if (GPSDOG_TRACK_TOLERANCE == 0) {
+        this->flushTrack();
+    }
+}
+
+uint8_t GDTrack::getTrack(GD_TRACK_POINT *points, uint8_t count)
+{
+    GD_TRACK_POINT  point;
+    uint8_t         skip;
+    uint8_t         pos     = 0;
+    uint8_t         stored;
+
+    if (count > this->getTrackCount()) {
+        count = this->getTrackCount();
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    // newest point is in window
+    stored = count;
+
+    if (m_trackWindowCount > 0) {
+        stored--;
+        memcpy(&points[stored], &m_trackWindow[m_trackWindowCount -1], sizeof(GD_TRACK_POINT));
+    }
+
+    skip = m_trackCount - stored;
+
+    memcpy(&point, &m_trackTail, sizeof(GD_TRACK_POINT));
+
+    // decode from oldest point
+    for (uint8_t i = 0; i < m_trackCount; i++) {
+        if (i > 0) {
+            pos += this->readRecord(pos, &point);
+        }
+
+        if (i >= skip) {
+            memcpy(&points[i - skip], &point, sizeof(GD_TRACK_POINT));
+        }
+    }
+
+    return count;
+}
+
+void GDTrack::saveTrack()
+{
+    GD_TRACK_POINT  tail;
+    uint8_t         header[GPSDOG_TRACK_HEADER];
+    uint8_t         pos     = 0;
+    uint8_t         count;
+    uint8_t         crc     = 0x00;
+    uint32_t        span;
+
+    // same as in EEPROM
+    if (!m_trackChanged) {
+        return;
+    }
+
+    m_trackChanged = false;
+
+    this->flushTrack();
+
+    count = m_trackCount;
+
+    // nothing to save
+    if (m_trackCount == 0) {
+        EEPROM.update(GPSDOG_TRACK_START, 0x00);
+        return;
+    }
+
+    memcpy(&tail, &m_trackTail, sizeof(GD_TRACK_POINT));
+
+    // skip oldest points they not fit
+    while (static_cast<uint8_t>(m_trackLen - pos) > GPSDOG_TRACK_SPILL) {
+        pos += this->readRecord(pos, &tail);
+        count--;
+    }
+
+    span = m_trackHead.m_time - tail.m_time;
+
+    ////
+    // Header
+    header[0]   = GPSDOG_TRACK_MAGIC;
+    memcpy(&header[1], &tail.m_latitude, 4);
+    memcpy(&header[5], &tail.m_longitude, 4);
+    memcpy(&header[9], &span, 4);
+    header[13]  = count;
+    header[14]  = m_trackLen - pos;
+
+    // invalidate old track
+    EEPROM.update(GPSDOG_TRACK_START, 0x00);
+
+    for (uint8_t i = 1; i < GPSDOG_TRACK_HEADER; i++) {
+        EEPROM.update(GPSDOG_TRACK_START + i, header[i]);
+        crc = _crc8_ccitt_update(crc, header[i]);
+    }
+
+    ////
+    // Data
+    for (uint8_t i = 0; i < header[14]; i++) {
+        uint8_t data = m_track[(static_cast<uint16_t>(m_trackStart) + pos + i) % GPSDOG_TRACK_SIZE];
+
+        EEPROM.update(GPSDOG_TRACK_START + GPSDOG_TRACK_HEADER + i, data);
+        crc = _crc8_ccitt_update(crc, data);
+    }
+
+    EEPROM.update(GPSDOG_TRACK_START + GPSDOG_TRACK_HEADER + header[14], crc);
+
+    // write magic at last
+    EEPROM.update(GPSDOG_TRACK_START, GPSDOG_TRACK_MAGIC);
+}
+
+bool GDTrack::loadTrack(uint32_t now)
+{
+    uint8_t     header[GPSDOG_TRACK_HEADER];
+    uint8_t     crc     = 0x00;
+    uint8_t     pos     = 0;
+    uint32_t    span;
+
+    m_trackCount        ^= m_trackCount;
+    m_trackWindowCount  ^= m_trackWindowCount;
+    m_trackChanged      = false;
+
+    ////
+    // Header
+    for (uint8_t i = 0; i < GPSDOG_TRACK_HEADER; i++) {
+        header[i] = EEPROM.read(GPSDOG_TRACK_START + i);
+
+        if (i > 0) {
+            crc = _crc8_ccitt_update(crc, header[i]);
+        }
+    }
+
+    if (header[0] != GPSDOG_TRACK_MAGIC || header[13] == 0 || header[14] > GPSDOG_TRACK_SPILL || header[14] > GPSDOG_TRACK_SIZE) {
+        return false;
+    }
+
+    ////
+    // Data
+    for (uint8_t i = 0; i < header[14]; i++) {
+        m_track[i]  = EEPROM.read(GPSDOG_TRACK_START + GPSDOG_TRACK_HEADER + i);
+        crc         = _crc8_ccitt_update(crc, m_track[i]);
+    }
+
+    if (crc != EEPROM.read(GPSDOG_TRACK_START + GPSDOG_TRACK_HEADER + header[14])) {
+        return false;
+    }
+
+    memcpy(&m_trackTail.m_latitude, &header[1], 4);
+    memcpy(&m_trackTail.m_longitude, &header[5], 4);
+    memcpy(&span, &header[9], 4);
+
+    m_trackTail.m_time  = now - span;
+    m_trackStart        ^= m_trackStart;
+    m_trackLen          = header[14];
+
+    ////
+    // Find newest point
+    memcpy(&m_trackHead, &m_trackTail, sizeof(GD_TRACK_POINT));
+
+    for (uint8_t i = 1; i < header[13]; i++) {
+        pos += this->readRecord(pos, &m_trackHead);
+    }
+
+    // records and count not match
+    if (pos != m_trackLen) {
+        m_trackLen ^= m_trackLen;
+        return false;
+    }
+
+    m_trackCount    = header[13];
+    m_trackCos      = GDGps::getCosLatitude(m_trackHead.m_latitude * GPSDOG_TRACK_QUANT);
+
+    return true;
+}
+
+// vim: set sts=4 sw=4 ts=4 et:
@@ -0,0 +1,226 @@
+
+#ifndef GDTRACK_H
+#define GDTRACK_H
+
+// includes
+#include <EEPROM.h>
+#include <inttypes.h>
+#include <string.h>
+#include <util/crc16.h>
+
+#include "GDGps.h"
+#include "GDSnap.h"
+
+// config
+#ifndef GPSDOG_TRACK_SIZE
+#define GPSDOG_TRACK_SIZE 128
+#endif
+
+// microdegrees of one track unit (1e-5 degrees, ~1 m)
+#define GPSDOG_TRACK_QUANT 10
+#define GPSDOG_TRACK_DIGITS 5
+
+// new point only if moved this meters
+#define GPSDOG_TRACK_MOVE 25
+
+// max error of the simplified track in meters, 0 is off
+#ifndef GPSDOG_TRACK_TOLERANCE
+#define GPSDOG_TRACK_TOLERANCE 15
+#endif
+
+// count of points they wait for simplification
+#define GPSDOG_TRACK_WINDOW 0x06
+
+// max axis length of a line in track units (~36 km), int64 is enough
+#define GPSDOG_TRACK_LINE_MAX 0x7FFF
+
+// max bytes of a record: 2 coordinates + time as varint
+#define GPSDOG_TRACK_RECORD 15
+
+// EEPROM spill area after snapshot slots until end of EEPROM
+// magic, tail lat, tail lon, time span, count, size, data..., crc
+#define GPSDOG_TRACK_START (GPSDOG_SNAP_START + GPSDOG_SNAP_SLOTS * sizeof(GD_SNAP))
+#define GPSDOG_TRACK_HEADER 15
+#define GPSDOG_TRACK_SPILL (E2END + 1 - GPSDOG_TRACK_START - GPSDOG_TRACK_HEADER - 1)
+#define GPSDOG_TRACK_MAGIC 0x54
+
+/**
+ * Point of track
+ */
+struct GD_TRACK_POINT
+{
+    /** Position in track units @see GPSDOG_TRACK_QUANT */
+    int32_t     m_latitude;
+    int32_t     m_longitude;
+
+    /** Time in sec */
+    uint32_t    m_time;
+};
+
+/**
+ * Object for a breadcrumb track in RAM. The points are in a ring buffer
+ * as delta to the point before, every value is a (zigzag) varint. The
+ * oldest point is full in RAM, so a drop need only decode one record.
+ *
+ * Before the ring buffer is a simplification (opening window). The new
+ * points wait in a small window as long as all of them are near the line
+ * from the newest stored point to the last point. If not, only the point
+ * before is stored.
+ */
+class GDTrack
+{
+    private:
+
+        /** Ring buffer with records */
+        uint8_t         m_track[GPSDOG_TRACK_SIZE];
+        uint8_t         m_trackStart;
+        uint8_t         m_trackLen;
+
+        /** Count of points with tail, 0 is empty */
+        uint8_t         m_trackCount;
+
+        /** Oldest and newest point */
+        GD_TRACK_POINT  m_trackTail;
+        GD_TRACK_POINT  m_trackHead;
+
+        /** cos of newest point latitude as Q14 */
+        uint16_t        m_trackCos;
+
+        /** Points they wait for simplification */
+        GD_TRACK_POINT  m_trackWindow[GPSDOG_TRACK_WINDOW];
+        uint8_t         m_trackWindowCount;
+
+        /** Track is changed since the last save / load */
+        bool            m_trackChanged;
+
+        /**
+         * Map a signed value to unsigned, small values give small
+         * varints.
+         */
+        static uint32_t toZigzag(int32_t val) {
+            return (static_cast<uint32_t>(val) << 1) ^ static_cast<uint32_t>(val >> 31);
+        }
+
+        /**
+         * Reverse of @see toZigzag.
+         */
+        static int32_t fromZigzag(uint32_t val) {
+            return static_cast<int32_t>(val >> 1) ^ -static_cast<int32_t>(val & 0x01);
+        }
+
+        /**
+         * Write a varint.
+         *
+         * @param buffer            Buffer with min. 5 bytes
+         * @param val               Value
+         * @return                  Count of bytes
+         */
+        static uint8_t writeVarint(uint8_t *buffer, uint32_t val);
+
+        /**
+         * Read a varint from ring buffer.
+         *
+         * @param pos               Position after the tail
+         * @param val               Value
+         * @return                  Count of bytes
+         */
+        uint8_t readVarint(uint8_t pos, uint32_t *val);
+
+        /**
+         * Read a record and add it to a point.
+         *
+         * @param pos               Position after the tail
+         * @param point             Point before, is set to the next point
+         * @return                  Count of bytes
+         */
+        uint8_t readRecord(uint8_t pos, GD_TRACK_POINT *point);
+
+        /**
+         * Drop the oldest point.
+         */
+        void dropTrack();
+
+        /**
+         * Store a point in ring buffer.
+         *
+         * @param point             Point in track units
+         */
+        void pushTrack(GD_TRACK_POINT *point);
+
+        /**
+         * Store the last point of window.
+         */
+        void flushTrack();
+
+        /**
+         * Check are all points in window near the line from newest
+         * stored point to a end point.
+         *
+         * @param end               End point of line
+         * @return                  TRUE if all points are in tolerance
+         */
+        bool isInTolerance(GD_TRACK_POINT *end);
+
+    public:
+
+        GDTrack();
+
+        /**
+         * Delete all points in RAM and EEPROM.
+         */
+        void cleanTrack();
+
+        /**
+         * Add a point to the track. A point near the newest point is
+         * skipped, the others go through the simplification.
+         *
+         * @param lat               Latitude in microdegrees
+         * @param lon               Longitude in microdegrees
+         * @param time              Time in sec
+         */
+        void addTrack(int32_t lat, int32_t lon, uint32_t time);
+
+        /**
+         * Read the newest points. The last point of window is the newest
+         * point.
+         *
+         * @param points            Buffer for points, oldest first
+         * @param count             Max count of points
+         * @return                  Count of points they are read
+         */
+        uint8_t getTrack(GD_TRACK_POINT *points, uint8_t count);
+
+        /**
+         * Getter for count of points
+         */
+        uint8_t getTrackCount() {
+            return m_trackCount + (m_trackWindowCount > 0 ? 1 : 0);
+        }
+
+        /**
+         * Getter for track is changed since the last save
+         */
+        bool isTrackChanged() {
+            return m_trackChanged;
+        }
+
+        /**
+         * Write the track to EEPROM. The window is stored before. The
+         * oldest points are skipped if the space is to small. Nothing is
+         * written if the track is not changed since the last save.
+         */
+        void saveTrack();
+
+        /**
+         * Read the track from EEPROM. The time before the reset is
+         * lost, so the newest point get the time now.
+         *
+         * @param now               Time in sec
+         * @return                  TRUE if a track is found
+         */
+        bool loadTrack(uint32_t now);
+};
+
+#endif
+
+// vim: set sts=4 sw=4 ts=4 et: